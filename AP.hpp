@@ -0,0 +1,94 @@
+#ifndef AP_HPP
+#define AP_HPP
+
+#include <set>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <memory>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <unordered_map>
+#include "Utils.hpp"
+
+// A set of atomic propositions, one bit per interned AP
+typedef uint64_t APMask;
+
+const int MAX_AP = 64;
+
+inline APMask APBit(int id) {
+   return ((APMask) 1) << id;
+}
+
+// Two labels agree on the APs in scope
+inline bool APEqual(APMask ap1, APMask ap2, APMask scope) {
+   return ((ap1 ^ ap2) & scope) == 0;
+}
+
+// Interning table for atomic propositions.
+// The TS registers its APs, so every AP name maps to one bit of an APMask.
+// The formula parser only looks names up: an AP that does not occur in the
+// TS gets no bit, and the guards leave it unconstrained.
+// Formulas may be parsed by several threads at once, so access is locked.
+class APTable {
+ private:
+   mutable std::mutex lock;
+   std::vector<std::string> names;
+   std::unordered_map<std::string, int> ids;
+ public:
+   int intern(const std::string &name) {
+      std::lock_guard<std::mutex> guard(lock);
+      auto it = ids.find(name);
+      if (it != ids.end()) {
+         return it->second;
+      }
+      if ((int) names.size() == MAX_AP) {
+         failwith("too many atomic propositions (at most %d)\n", MAX_AP);
+         exit(EXIT_FAILURE);
+      }
+      ids[name] = names.size();
+      names.push_back(name);
+      return names.size() - 1;
+   }
+   int lookup(const std::string &name) const {
+      std::lock_guard<std::mutex> guard(lock);
+      auto it = ids.find(name);
+      return it == ids.end() ? -1 : it->second;
+   }
+   int size() const {
+      std::lock_guard<std::mutex> guard(lock);
+      return names.size();
+   }
+   std::string get_name(int id) const {
+      std::lock_guard<std::mutex> guard(lock);
+      return names[id];
+   }
+   std::set<std::string> get_names(APMask mask) const {
+      std::lock_guard<std::mutex> guard(lock);
+      std::set<std::string> ap;
+      for (int i = 0; i < (int) names.size(); ++i) {
+         if (mask & APBit(i)) ap.insert(names[i]);
+      }
+      return ap;
+   }
+};
+
+typedef std::shared_ptr<APTable> APTablePtr;
+
+// Print a mask as the set of AP ids it contains
+inline std::ostream& PrintAPMask(std::ostream &os, APMask mask) {
+   os << "{";
+   bool first = true;
+   for (int i = 0; i < MAX_AP; ++i) {
+      if (mask & APBit(i)) {
+         if (!first) os << ", ";
+         os << i;
+         first = false;
+      }
+   }
+   return os << "}";
+}
+
+#endif
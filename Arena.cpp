@@ -0,0 +1,25 @@
+#include <cstdint>
+#include "Arena.hpp"
+
+// A request larger than a quarter chunk gets a chunk of its own, so the
+// space left in the current chunk is not wasted on it
+void* Arena::allocate(size_t bytes, size_t align) {
+   size_t pad = (align - (uintptr_t) next % align) % align;
+   if (pad + bytes > left) {
+      if (bytes > chunk_size / 4) {
+         chunks.emplace_back(new char[bytes + align]);
+         char *start = chunks.back().get();
+         used += bytes;
+         return start + (align - (uintptr_t) start % align) % align;
+      }
+      chunks.emplace_back(new char[chunk_size]);
+      next = chunks.back().get();
+      left = chunk_size;
+      pad = (align - (uintptr_t) next % align) % align;
+   }
+   char *result = next + pad;
+   next += pad + bytes;
+   left -= pad + bytes;
+   used += bytes;
+   return result;
+}
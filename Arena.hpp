@@ -0,0 +1,57 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// Bump allocator for objects that die together. Memory is handed out from
+// large chunks in order and is only given back, all at once, when the arena
+// is destroyed, so freeing a single object does nothing.
+// An arena is not thread-safe; it belongs to whoever builds the objects.
+class Arena {
+ private:
+   std::vector<std::unique_ptr<char[]>> chunks;
+   char *next;
+   size_t left;
+   size_t chunk_size;
+   // bytes handed out
+   size_t used;
+ public:
+   Arena(size_t chunk_size = 16 << 10) : next(nullptr), left(0), chunk_size(chunk_size), used(0) {}
+   Arena(const Arena &arena) = delete;
+   Arena& operator=(const Arena &arena) = delete;
+   void* allocate(size_t bytes, size_t align);
+   size_t get_used() const {
+      return used;
+   }
+};
+
+// Standard allocator on an arena, for containers and std::allocate_shared.
+// Deallocating does nothing; the memory goes with the arena, which must
+// outlive everything allocated from it.
+template <typename T>
+class ArenaAllocator {
+   template <typename U> friend class ArenaAllocator;
+ private:
+   Arena *arena;
+ public:
+   typedef T value_type;
+   ArenaAllocator(Arena *arena) : arena(arena) {}
+   template <typename U>
+   ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+   T* allocate(size_t n) {
+      return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+   }
+   void deallocate(T*, size_t) {}
+   template <typename U>
+   bool operator==(const ArenaAllocator<U> &other) const {
+      return arena == other.arena;
+   }
+   template <typename U>
+   bool operator!=(const ArenaAllocator<U> &other) const {
+      return arena != other.arena;
+   }
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef AUTOMATON_CACHE_HPP
+#define AUTOMATON_CACHE_HPP
+
+#include <mutex>
+#include <string>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include "NBA.hpp"
+
+// Caches the automaton translated from each formula, keyed by the canonical form of
+// the simplified negated formula. When several threads ask for the same key,
+// the first one translates and the others wait for its result, so every
+// formula is translated once per run.
+class AutomatonCache {
+ private:
+   std::mutex lock;
+   std::unordered_map<std::string, std::shared_future<std::shared_ptr<NBA_base>>> cache;
+   int hits, misses;
+ public:
+   AutomatonCache() : hits(0), misses(0) {}
+   std::shared_ptr<NBA_base> get(const std::string &key, const std::function<std::shared_ptr<NBA_base>()> &translate) {
+      std::promise<std::shared_ptr<NBA_base>> promise;
+      std::shared_future<std::shared_ptr<NBA_base>> result;
+      bool found;
+      {
+         std::lock_guard<std::mutex> guard(lock);
+         auto it = cache.find(key);
+         found = it != cache.end();
+         if (found) {
+            ++hits;
+            result = it->second;
+         } else {
+            ++misses;
+            cache[key] = promise.get_future().share();
+         }
+      }
+      if (found) {
+         return result.get();
+      }
+      std::shared_ptr<NBA_base> automaton = translate();
+      promise.set_value(automaton);
+      return automaton;
+   }
+   int get_hits() const {
+      return hits;
+   }
+   int get_misses() const {
+      return misses;
+   }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef BITSET_HPP
+#define BITSET_HPP
+
+#include <vector>
+#include <cstdint>
+
+// A fixed-size set of small integers, stored as 64-bit words
+class Bitset {
+ private:
+   int bit_count;
+   std::vector<uint64_t> words;
+ public:
+   Bitset() : bit_count(0) {}
+   Bitset(int bit_count) : bit_count(bit_count), words((bit_count + 63) / 64, 0) {}
+   int size() const {
+      return bit_count;
+   }
+   bool test(int i) const {
+      return (words[i >> 6] >> (i & 63)) & 1;
+   }
+   void set(int i) {
+      words[i >> 6] |= ((uint64_t) 1) << (i & 63);
+   }
+   void reset(int i) {
+      words[i >> 6] &= ~(((uint64_t) 1) << (i & 63));
+   }
+   void assign(int i, bool value) {
+      if (value) set(i);
+      else reset(i);
+   }
+   int count() const {
+      int result = 0;
+      for (auto &w : words) {
+         result += __builtin_popcountll(w);
+      }
+      return result;
+   }
+   // Call f(i) for every element in increasing order
+   template <typename F>
+   void for_each(F f) const {
+      for (size_t i = 0; i < words.size(); ++i) {
+         for (uint64_t w = words[i]; w; w &= w - 1) {
+            f((int) (i * 64 + __builtin_ctzll(w)));
+         }
+      }
+   }
+   // Whether the two sets share an element
+   bool intersects(const Bitset &other) const {
+      for (size_t i = 0; i < words.size(); ++i) {
+         if (words[i] & other.words[i]) return true;
+      }
+      return false;
+   }
+   bool operator==(const Bitset &other) const {
+      return bit_count == other.bit_count && words == other.words;
+   }
+   bool operator!=(const Bitset &other) const {
+      return !(*this == other);
+   }
+   const std::vector<uint64_t>& get_words() const {
+      return words;
+   }
+};
+
+#endif
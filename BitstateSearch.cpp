@@ -0,0 +1,125 @@
+#include <cmath>
+#include "BitstateSearch.hpp"
+
+BitstateSet::BitstateSet(uint64_t bytes, int hash_count)
+   : words(std::max<uint64_t>(bytes / 8, 1), 0), bit_count(words.size() * 64), bits_set(0),
+     hash_count(std::max(hash_count, 1)), stored(0), expected_lost(0) {}
+
+// The i-th bit of a key is h1 + i * h2, mapped onto the bits by a multiply
+// instead of a modulo
+bool BitstateSet::insert(uint64_t key) {
+   uint64_t h1 = MixKey(key);
+   uint64_t h2 = MixKey(h1) | 1;
+   double full = std::pow(get_fill(), hash_count);
+   int added = 0;
+   for (int i = 0; i < hash_count; ++i) {
+      uint64_t bit = (uint64_t) (((unsigned __int128) (h1 + i * h2) * bit_count) >> 64);
+      uint64_t mask = 1ull << (bit & 63);
+      if (words[bit >> 6] & mask) continue;
+      words[bit >> 6] |= mask;
+      ++added;
+   }
+   if (added == 0) return false;
+   bits_set += added;
+   ++stored;
+   // for every key stored at this fill, full / (1 - full) new ones were
+   // expected to hit set bits only
+   expected_lost += full / std::max(1 - full, 1e-12);
+   return true;
+}
+
+bool BitstateSearch::is_accepting(uint64_t key) const {
+   return prod->acceptance[(uint32_t) key] == prod->full_acceptance;
+}
+
+// Generate the successors of a state onto the shared successor array
+void BitstateSearch::push(std::vector<Frame> &stack, uint64_t key) {
+   size_t begin = successors.size();
+   prod->for_each_reduced_successor(get_ts_id(key), (uint32_t) key, in_ample, [&](int i2, int j2) {
+      prod->mark_seen(i2);
+      successors.push_back(pack(i2, j2));
+   });
+   stack.push_back(Frame{key, begin, begin, successors.size()});
+}
+
+// The frames of both stacks are nested, so the successors of the top frame
+// are at the end of the array
+void BitstateSearch::pop(std::vector<Frame> &stack) {
+   successors.resize(stack.back().begin);
+   stack.pop_back();
+}
+
+// Same as NestedDFSProcessor::make_lasso, in TS states
+void BitstateSearch::make_lasso(Lasso *lasso, uint64_t entry, int red_from) const {
+   lasso->prefix.clear();
+   lasso->cycle.clear();
+   bool on_cycle = false;
+   for (auto &frame : blue_stack) {
+      on_cycle = on_cycle || frame.key == entry;
+      (on_cycle ? lasso->cycle : lasso->prefix).push_back(get_ts_id(frame.key));
+   }
+   for (int i = red_from; i < (int) red_stack.size(); ++i) {
+      lasso->cycle.push_back(get_ts_id(red_stack[i].key));
+   }
+}
+
+// Outer search, as in NestedDFSProcessor::blue_dfs
+bool BitstateSearch::blue_dfs(uint64_t init, Lasso *lasso) {
+   ++state_count;
+   on_stack.insert(init);
+   push(blue_stack, init);
+   while (!blue_stack.empty()) {
+      Frame &frame = blue_stack.back();
+      uint64_t node = frame.key;
+      if (frame.next < frame.end) {
+         uint64_t to = successors[frame.next++];
+         if (on_stack.count(to) && (is_accepting(node) || is_accepting(to))) {
+            if (lasso) make_lasso(lasso, to, 0);
+            return true;
+         }
+         if (visited.insert(to)) {
+            ++state_count;
+            on_stack.insert(to);
+            push(blue_stack, to);
+         }
+         continue;
+      }
+      if (is_accepting(node) && red_dfs(node, lasso)) return true;
+      on_stack.erase(node);
+      pop(blue_stack);
+   }
+   return false;
+}
+
+// Inner search, as in NestedDFSProcessor::red_dfs. The successors of the
+// seed are generated again, the outer search has used them up.
+bool BitstateSearch::red_dfs(uint64_t seed, Lasso *lasso) {
+   visited.insert(seed | RED);
+   push(red_stack, seed);
+   while (!red_stack.empty()) {
+      Frame &frame = red_stack.back();
+      if (frame.next < frame.end) {
+         uint64_t to = successors[frame.next++];
+         if (on_stack.count(to)) {
+            // the seed is the top of the outer stack, so the cycle goes on from it
+            if (lasso) make_lasso(lasso, to, 1);
+            red_stack.clear();
+            return true;
+         }
+         if (visited.insert(to | RED)) push(red_stack, to);
+         continue;
+      }
+      pop(red_stack);
+   }
+   return false;
+}
+
+bool BitstateSearch::find_accepting_cycle(Lasso *lasso) {
+   for (auto &i : prod->get_initial()) {
+      uint64_t key = pack(prod->get_ts_state(i), prod->get_nba_state(i));
+      if (visited.insert(key) && blue_dfs(key, lasso)) {
+         return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,97 @@
+#ifndef BITSTATE_SEARCH_HPP
+#define BITSTATE_SEARCH_HPP
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_set>
+#include "Product.hpp"
+
+// Bloom filter over 64-bit keys in a fixed number of bits. A key sets k bits
+// picked by double hashing; a key whose k bits are all set counts as stored,
+// so a new key can be taken for a stored one but never the other way round.
+class BitstateSet {
+ private:
+   std::vector<uint64_t> words;
+   uint64_t bit_count;
+   uint64_t bits_set;
+   int hash_count;
+   uint64_t stored;
+   // expected number of new keys that were taken for stored ones
+   double expected_lost;
+ public:
+   BitstateSet(uint64_t bytes, int hash_count);
+   // Returns true if the key was not stored yet
+   bool insert(uint64_t key);
+   uint64_t get_stored() const {
+      return stored;
+   }
+   uint64_t get_bit_count() const {
+      return bit_count;
+   }
+   // fraction of the bits that are set
+   double get_fill() const {
+      return (double) bits_set / bit_count;
+   }
+   // estimated fraction of the reached states that were not lost
+   double get_coverage() const {
+      return stored / (stored + expected_lost);
+   }
+};
+
+// Nested DFS on the fly in bitstate (supertrace) mode, for products too
+// large to store. The states are never numbered: a state is the key of its
+// (TS state, NBA state) pair, the visited states of both searches are one
+// BitstateSet in a fixed memory budget, and only the stacks hold states
+// exactly. The successors of a state are generated when it is pushed.
+// A state that hashes onto set bits is skipped with everything only
+// reachable through it, so "no accepting cycle" is probabilistic. Membership
+// in the outer stack is exact, so a cycle that is found exists.
+class BitstateSearch {
+ private:
+   struct Frame {
+      uint64_t key;
+      // the successors of the state are successors[begin .. end), and
+      // next is the first one not taken yet
+      size_t begin;
+      size_t next;
+      size_t end;
+   };
+   std::shared_ptr<Product> prod;
+   BitstateSet visited;
+   // states on the outer stack
+   std::unordered_set<uint64_t> on_stack;
+   std::vector<Frame> blue_stack, red_stack;
+   std::vector<uint64_t> successors;
+   std::vector<char> in_ample;
+   // states reached by the outer search
+   uint64_t state_count;
+   static uint64_t pack(int ts_id, int nba_id) {
+      return ((uint64_t) ts_id << 32) | (uint32_t) nba_id;
+   }
+   static int get_ts_id(uint64_t key) {
+      return (key >> 32) & 0x7fffffff;
+   }
+   // the inner search stores its states with this bit, which no key has
+   static const uint64_t RED = 1ull << 63;
+   bool is_accepting(uint64_t key) const;
+   void push(std::vector<Frame> &stack, uint64_t key);
+   void pop(std::vector<Frame> &stack);
+   void make_lasso(Lasso *lasso, uint64_t entry, int red_from) const;
+   bool blue_dfs(uint64_t init, Lasso *lasso);
+   bool red_dfs(uint64_t seed, Lasso *lasso);
+ public:
+   // bytes of bits for the visited states, each stored with hash_count bits
+   BitstateSearch(std::shared_ptr<Product> prod, uint64_t bytes, int hash_count)
+      : prod(prod), visited(bytes, hash_count), state_count(0) {}
+   // With a lasso, the run is given in TS states
+   bool find_accepting_cycle(Lasso *lasso = nullptr);
+   uint64_t get_state_count() const {
+      return state_count;
+   }
+   const BitstateSet& get_visited() const {
+      return visited;
+   }
+};
+
+#endif
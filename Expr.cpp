@@ -1,158 +1,223 @@
 #include <memory>
+#include <sstream>
+#include <algorithm>
 #include "Expr.hpp"
 
-// Check the equality of two expressions by comparing the syntax tree
-bool ExprEqual(ExprPtr expr1, ExprPtr expr2) {
-   if (expr1->get_type() != expr2->get_type()) return false;
-   if (expr1->get_type() == ExprType::VAR) {
-      VarExprPtr var_expr1 = std::dynamic_pointer_cast<VarExpr>(expr1);
-      VarExprPtr var_expr2 = std::dynamic_pointer_cast<VarExpr>(expr2);
-      return var_expr1->get_var() == var_expr2->get_var();
-   } else if (expr1->is_unary()) {
-      UnaryExprPtr unary_expr1 = std::dynamic_pointer_cast<UnaryExpr>(expr1);
-      UnaryExprPtr unary_expr2 = std::dynamic_pointer_cast<UnaryExpr>(expr2);
-      return ExprEqual(unary_expr1->get_expr(), unary_expr2->get_expr());
-   } else if (expr1->is_binary()) {
-      BinaryExprPtr binary_expr1 = std::dynamic_pointer_cast<BinaryExpr>(expr1);
-      BinaryExprPtr binary_expr2 = std::dynamic_pointer_cast<BinaryExpr>(expr2);
-      return ExprEqual(binary_expr1->get_left(), binary_expr2->get_left()) && 
-             ExprEqual(binary_expr1->get_right(), binary_expr2->get_right());
-   }
-   return true;
+ExprPtr ExprFactory::make_true() {
+   Key key{ExprType::TRUE, -1, -1};
+   auto it = table.find(key);
+   if (it != table.end()) return it->second;
+   return table[key] = add<Expr>(ExprType::TRUE);
+}
+
+ExprPtr ExprFactory::make_var(const std::string &var, int ap_id) {
+   auto it = vars.find(var);
+   if (it != vars.end()) return it->second;
+   return vars[var] = add<VarExpr>(var, ap_id);
+}
+
+ExprPtr ExprFactory::make_unary(ExprType type, const ExprPtr &expr) {
+   Key key{type, expr->get_id(), -1};
+   auto it = table.find(key);
+   if (it != table.end()) return it->second;
+   return table[key] = add<UnaryExpr>(type, expr);
+}
+
+ExprPtr ExprFactory::make_binary(ExprType type, const ExprPtr &left, const ExprPtr &right) {
+   Key key{type, left->get_id(), right->get_id()};
+   auto it = table.find(key);
+   if (it != table.end()) return it->second;
+   return table[key] = add<BinaryExpr>(type, left, right);
+}
+
+static thread_local ExprFactory *current_factory = nullptr;
+
+ExprFactory& GetExprFactory() {
+   static thread_local ExprFactory factory;
+   return current_factory ? *current_factory : factory;
+}
+
+ExprScope::ExprScope() : outer(current_factory) {
+   current_factory = &factory;
+}
+
+ExprScope::~ExprScope() {
+   current_factory = outer;
+}
+
+// Expressions are hash-consed, so structurally equal expressions are the same node
+bool ExprEqual(const ExprPtr &expr1, const ExprPtr &expr2) {
+   return expr1 == expr2;
 }
 
 // Calculate the negation of an expression(Will eliminate double negation)
-ExprPtr ExprCalcNeg(ExprPtr expr) {
+ExprPtr ExprCalcNeg(const ExprPtr &expr) {
    if (expr->get_type() == ExprType::NEG) {
-      UnaryExprPtr unary_expr = std::dynamic_pointer_cast<UnaryExpr>(expr);
-      return unary_expr->get_expr();
+      return static_cast<UnaryExpr&>(*expr).get_expr();
    } else {
-      return std::make_shared<UnaryExpr>(ExprType::NEG, expr);
+      return GetExprFactory().make_unary(ExprType::NEG, expr);
    }
 }
 
 // Simplify the expression
 // eliminate double negation
 // eliminate \/, ->, always, eventually
-ExprPtr ExprSimplify(ExprPtr expr) {
-   if (expr->get_type() == ExprType::NEG || expr->get_type() == ExprType::ALWAYS || 
-            expr->get_type() == ExprType::EVENTUALLY || expr->get_type() == ExprType::NEXT) {
-      UnaryExprPtr unary_expr = std::dynamic_pointer_cast<UnaryExpr>(expr);
-      unary_expr->set_expr(ExprSimplify(unary_expr->get_expr()));
+ExprPtr ExprSimplify(const ExprPtr &expr) {
+   ExprFactory &factory = GetExprFactory();
+   if (expr->is_unary()) {
+      ExprPtr sub = ExprSimplify(static_cast<UnaryExpr&>(*expr).get_expr());
       if (expr->get_type() == ExprType::NEG) {                                 // !!a = a
-         if (unary_expr->get_expr().get()->get_type() == ExprType::NEG) {
-            UnaryExprPtr sub_unary_expr = std::dynamic_pointer_cast<UnaryExpr>(unary_expr->get_expr());
-            expr = ExprSimplify(sub_unary_expr->get_expr());
-         }
+         return ExprCalcNeg(sub);
       } else if (expr->get_type() == ExprType::ALWAYS) {                       // always P = !eventually !P
-         expr = std::make_shared<UnaryExpr>(ExprType::NEG, 
-                  std::make_shared<UnaryExpr>(ExprType::EVENTUALLY, 
-                     std::make_shared<UnaryExpr>(ExprType::NEG, unary_expr->get_expr())));
-         expr = ExprSimplify(expr);
+         return ExprCalcNeg(factory.make_binary(ExprType::UNTIL, factory.make_true(), ExprCalcNeg(sub)));
       } else if (expr->get_type() == ExprType::EVENTUALLY) {                   // eventually P = true U P
-         expr = std::make_shared<BinaryExpr>(ExprType::UNTIL, 
-                     std::make_shared<Expr>(ExprType::TRUE), unary_expr->get_expr());
+         return factory.make_binary(ExprType::UNTIL, factory.make_true(), sub);
       }
-   } else if (expr->get_type() == ExprType::DISJ || expr->get_type() == ExprType::IMPL || 
-              expr->get_type() == ExprType::CONJ || expr->get_type() == ExprType::UNTIL) {
-      BinaryExprPtr binary_expr = std::dynamic_pointer_cast<BinaryExpr>(expr);
-      binary_expr->set_left(ExprSimplify(binary_expr->get_left()));
-      binary_expr->set_right(ExprSimplify(binary_expr->get_right()));
+      return factory.make_unary(expr->get_type(), sub);
+   } else if (expr->is_binary()) {
+      BinaryExpr &binary_expr = static_cast<BinaryExpr&>(*expr);
+      ExprPtr left = ExprSimplify(binary_expr.get_left());
+      ExprPtr right = ExprSimplify(binary_expr.get_right());
       if (expr->get_type() == ExprType::DISJ) {                                // a \/ b = !(!a /\ !b)
-         expr = std::make_shared<UnaryExpr>(ExprType::NEG, 
-                  std::make_shared<BinaryExpr>(ExprType::CONJ, 
-                     std::make_shared<UnaryExpr>(ExprType::NEG, binary_expr->get_left()), 
-                     std::make_shared<UnaryExpr>(ExprType::NEG, binary_expr->get_right())));
-         expr = ExprSimplify(expr);
+         return factory.make_unary(ExprType::NEG, 
+                  factory.make_binary(ExprType::CONJ, ExprCalcNeg(left), ExprCalcNeg(right)));
       } else if (expr->get_type() == ExprType::IMPL) {                         // a -> b = !a \/ b
-         expr = std::make_shared<BinaryExpr>(ExprType::DISJ, 
-                  std::make_shared<UnaryExpr>(ExprType::NEG, binary_expr->get_left()), binary_expr->get_right());
-         expr = ExprSimplify(expr);
+         return factory.make_unary(ExprType::NEG, 
+                  factory.make_binary(ExprType::CONJ, left, ExprCalcNeg(right)));
       }
+      return factory.make_binary(expr->get_type(), left, right);
    }
    return expr;
 }
 
+// A textual form of the expression that is equal for expressions that only
+// differ in the order of the operands of /\, used as a key across threads
+std::string ExprCanonical(const ExprPtr &expr) {
+   std::ostringstream os;
+   if (expr->get_type() == ExprType::VAR) {
+      os << *expr;
+   } else if (expr->is_unary()) {
+      os << expr->get_type() << "(" << ExprCanonical(static_cast<UnaryExpr&>(*expr).get_expr()) << ")";
+   } else if (expr->is_binary()) {
+      BinaryExpr &binary_expr = static_cast<BinaryExpr&>(*expr);
+      std::string left = ExprCanonical(binary_expr.get_left());
+      std::string right = ExprCanonical(binary_expr.get_right());
+      if (expr->get_type() == ExprType::CONJ && right < left) std::swap(left, right);
+      os << "(" << left << " " << expr->get_type() << " " << right << ")";
+   } else {
+      os << expr->get_type();
+   }
+   return os.str();
+}
+
+// Whether X occurs in the expression
+bool ExprHasNext(const ExprPtr &expr) {
+   if (expr->get_type() == ExprType::NEXT) {
+      return true;
+   } else if (expr->is_unary()) {
+      return ExprHasNext(static_cast<UnaryExpr&>(*expr).get_expr());
+   } else if (expr->is_binary()) {
+      BinaryExpr &binary_expr = static_cast<BinaryExpr&>(*expr);
+      return ExprHasNext(binary_expr.get_left()) || ExprHasNext(binary_expr.get_right());
+   }
+   return false;
+}
+
 // Build the closure of the expression
-void Closure::build_closure(ExprPtr expr) {
+void Closure::build_closure(const ExprPtr &expr) {
    if (!contains(expr)) {
       ExprPtr neg = ExprCalcNeg(expr);
       add(expr, neg);
    }
    if (expr->is_unary()) {
-      UnaryExprPtr unary_expr = std::dynamic_pointer_cast<UnaryExpr>(expr);
-      build_closure(unary_expr->get_expr());
+      UnaryExpr &unary_expr = static_cast<UnaryExpr&>(*expr);
+      build_closure(unary_expr.get_expr());
    } else if (expr->is_binary()) {
-      BinaryExprPtr binary_expr = std::dynamic_pointer_cast<BinaryExpr>(expr);
-      build_closure(binary_expr->get_left());
-      build_closure(binary_expr->get_right());
+      BinaryExpr &binary_expr = static_cast<BinaryExpr&>(*expr);
+      build_closure(binary_expr.get_left());
+      build_closure(binary_expr.get_right());
    }
 }
 
-// Check if the a set of expressions is elementary
-bool IsElementary(std::shared_ptr<Closure> closure, ExprSet &elementary) {
-   // consistent with respect to propositional logic
-   for (int i = 0; i < closure->size(); ++i) {
-      ExprPtr expr = closure->get_ith(i);
-      ExprPtr neg = ExprCalcNeg(expr);
-      bool flag1 = elementary.contains(expr);
-      bool flag2 = elementary.contains(neg);
-      if (!(flag1 ^ flag2)) return false;
-   }
-   for (int i = 0; i < closure->size(); ++i) {
-      ExprPtr expr = closure->get_ith(i);
-      if (expr->get_type() == ExprType::CONJ) {
-         ExprPtr left = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_left();
-         ExprPtr right = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_right();
-         bool flag1 = elementary.contains(expr);
-         bool flag2 = elementary.contains(left) && elementary.contains(right);
-         if (flag1 != flag2) return false;
-      }
-   }
-   {
-      ExprPtr true_expr = std::make_shared<Expr>(ExprType::TRUE);
-      bool flag1 = elementary.contains(true_expr);
-      bool flag2 = closure->contains(true_expr);
-      if (flag1 != flag2) return false;
-   }
-   // local consistency
-   for (int i = 0; i < closure->size(); ++i) {
-      ExprPtr expr = closure->get_ith(i);
-      if (expr->get_type() == ExprType::UNTIL) {
-         ExprPtr left = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_left();
-         ExprPtr right = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_right();
-         if (elementary.contains(right) && !elementary.contains(expr)) {
-            return false;
-         }
-         if (elementary.contains(expr) && !elementary.contains(left) && !elementary.contains(right)) {
-            return false;
-         }
+void Closure::build_operands() {
+   left.assign(size(), -1);
+   right.assign(size(), -1);
+   for (int i = 0; i < size(); ++i) {
+      ExprPtr expr = get_ith(i);
+      if (expr->is_unary()) {
+         left[i] = get_id(static_cast<UnaryExpr&>(*expr).get_expr());
+      } else if (expr->is_binary()) {
+         left[i] = get_id(static_cast<BinaryExpr&>(*expr).get_left());
+         right[i] = get_id(static_cast<BinaryExpr&>(*expr).get_right());
       }
    }
-   return true;
 }
 
-void ElementarySet::build_elementary_helper(std::shared_ptr<Closure> closure, int pos, ExprSet &elementary) {
-   if (pos == closure->size()) {
-      if (IsElementary(closure, elementary)) {
-         elementaries.push_back(elementary.copy());
-      }
+// Decide the expressions of the closure one by one, operands before the
+// expressions built from them, and only branch where the definition of an
+// elementary set leaves a choice:
+// - exactly one of psi and !psi is in the set, so only non-negated
+//   expressions are decided and their negations follow
+// - true is always in the set
+// - psi1 /\ psi2 is in the set iff both operands are
+// - psi1 U psi2 is in the set if psi2 is, and is not if neither operand is
+// Every leaf of the search is an elementary set, so nothing is rejected later.
+void ElementarySet::build_elementary_helper(std::shared_ptr<Closure> closure, int pos, Elementary &elementary) {
+   if (pos == (int) order.size()) {
+      elementaries.push_back(elementary);
       return;
    }
-   ExprPtr expr = closure->get_ith(pos);
-   if (!elementary.contains(ExprCalcNeg(expr))) {
-      elementary.get_exprs().push_back(expr);
+   int i = order[pos];
+   int neg = closure->get_negation_id(i);
+   int left = closure->get_left_id(i), right = closure->get_right_id(i);
+   int choice = -1;
+   switch (closure->get_ith(i)->get_type()) {
+      case ExprType::TRUE:
+         choice = 1;
+         break;
+      case ExprType::CONJ:
+         choice = elementary.test(left) && elementary.test(right);
+         break;
+      case ExprType::UNTIL:
+         if (elementary.test(right)) choice = 1;
+         else if (!elementary.test(left)) choice = 0;
+         break;
+      default:
+         break;
+   }
+   for (int value = 1; value >= 0; --value) {
+      if (choice != -1 && choice != value) continue;
+      elementary.assign(i, value);
+      elementary.assign(neg, !value);
       build_elementary_helper(closure, pos + 1, elementary);
-      elementary.get_exprs().pop_back();
    }
-   build_elementary_helper(closure, pos + 1, elementary);
 }
 
 // calculate the elementary set
 void ElementarySet::build_elementary(std::shared_ptr<Closure> closure) {
-   ExprSet elementary;
-   build_elementary_helper(closure, 0, elementary);
    this->closure = closure;
+   for (int i = 0; i < closure->size(); ++i) {
+      if (closure->get_ith(i)->get_type() != ExprType::NEG) {
+         order.push_back(i);
+      }
+   }
+   // children are created before their parents, so they have smaller ids
+   std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return closure->get_ith(a)->get_id() < closure->get_ith(b)->get_id();
+   });
+   Elementary elementary(closure->size());
+   build_elementary_helper(closure, 0, elementary);
+   for (auto &e : elementaries) {
+      APMask ap = 0;
+      for (int i = 0; i < closure->size(); ++i) {
+         ExprPtr expr = closure->get_ith(i);
+         if (e.test(i) && expr->get_type() == ExprType::VAR) {
+            VarExpr &var_expr = static_cast<VarExpr&>(*expr);
+            if (var_expr.get_ap_id() >= 0) ap |= APBit(var_expr.get_ap_id());
+         }
+      }
+      aps.push_back(ap);
+   }
 }
 
 std::ostream &operator<<(std::ostream &os, ExprType type) {
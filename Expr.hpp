@@ -5,7 +5,12 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <string>
 #include <iostream>
+#include <unordered_map>
+#include "AP.hpp"
+#include "Arena.hpp"
+#include "Bitset.hpp"
 
 enum class ExprType {
    TRUE, VAR, NEG, CONJ, DISJ, IMPL, NEXT, ALWAYS, EVENTUALLY, UNTIL
@@ -13,15 +18,19 @@ enum class ExprType {
 
 std::ostream &operator<<(std::ostream &os, ExprType type);
 
+// Expressions are immutable and hash-consed by ExprFactory, so structurally
+// equal expressions are the same node and share the same id
 class Expr {
+   friend class ExprFactory;
  protected:
    ExprType type;
+   int id;
    virtual std::ostream& print(std::ostream &os) const {
       return os << type;
    }
  public: 
-   Expr(ExprType type) : type(type) {}
-   Expr(const Expr &expr) : type(expr.type) {}
+   Expr(ExprType type) : type(type), id(-1) {}
+   Expr(const Expr &expr) : type(expr.type), id(expr.id) {}
    bool is_unary() const {
       return type == ExprType::NEG || type == ExprType::NEXT || 
              type == ExprType::ALWAYS || type == ExprType::EVENTUALLY;
@@ -31,6 +40,7 @@ class Expr {
    }
    virtual ~Expr() {}
    ExprType get_type() const { return type; }
+   int get_id() const { return id; }
    friend std::ostream& operator<<(std::ostream &os, const Expr &expr);
 };
 
@@ -40,10 +50,12 @@ typedef std::shared_ptr<const Expr> ConstExprPtr;
 class VarExpr : public Expr {
  private:
    std::string var;
+   int ap_id;
  public:
-   VarExpr(std::string var) : Expr(ExprType::VAR), var(var) {}
-   VarExpr(const VarExpr &expr) : Expr(expr), var(expr.var) {}
+   VarExpr(std::string var, int ap_id = -1) : Expr(ExprType::VAR), var(var), ap_id(ap_id) {}
+   VarExpr(const VarExpr &expr) : Expr(expr), var(expr.var), ap_id(expr.ap_id) {}
    std::string get_var() { return var; }
+   int get_ap_id() { return ap_id; }
    std::ostream& print(std::ostream &os) const override {
       return os << var;
    }
@@ -58,8 +70,7 @@ class UnaryExpr : public Expr {
    }
    UnaryExpr(const UnaryExpr &expr) : Expr(expr), expr(expr.expr) {}
    ~UnaryExpr() {}
-   void set_expr(ExprPtr expr) { this->expr = std::move(expr); }
-   ExprPtr get_expr() { return expr; }
+   const ExprPtr& get_expr() const { return expr; }
    std::ostream& print(std::ostream &os) const override {
       return os << get_type() << "(" << *expr << ")";
    }
@@ -76,10 +87,8 @@ class BinaryExpr : public Expr {
    }
    BinaryExpr(const BinaryExpr &expr) : Expr(expr), left(expr.left), right(expr.right) {}
    ~BinaryExpr() {}
-   void set_left(ExprPtr left) { this->left = std::move(left); }
-   void set_right(ExprPtr right) { this->right = std::move(right); }
-   ExprPtr get_left() { return left; }
-   ExprPtr get_right() { return right; }
+   const ExprPtr& get_left() const { return left; }
+   const ExprPtr& get_right() const { return right; }
    std::ostream& print(std::ostream &os) const override {
       return os << "(" << *left << " " << get_type() << " " << *right << ")";
    }
@@ -89,103 +98,169 @@ typedef std::shared_ptr<VarExpr> VarExprPtr;
 typedef std::shared_ptr<UnaryExpr> UnaryExprPtr;
 typedef std::shared_ptr<BinaryExpr> BinaryExprPtr;
 
-bool ExprEqual(ExprPtr expr1, ExprPtr expr2);
-ExprPtr ExprCalcNeg(ExprPtr expr);
-ExprPtr ExprSimplify(ExprPtr expr);
+// Creates every expression node. A node is looked up by its type and the ids
+// of its children (or its name for a variable) before a new one is made, and
+// ids are handed out in creation order, so children have smaller ids.
+// The nodes are allocated in the arena of the factory and freed with it.
+// Each thread uses its own factory (see GetExprFactory).
+class ExprFactory {
+ private:
+   // declared first, so the nodes are released before their memory
+   Arena arena;
+   struct Key {
+      ExprType type;
+      int left, right;
+      bool operator==(const Key &key) const {
+         return type == key.type && left == key.left && right == key.right;
+      }
+   };
+   struct KeyHash {
+      size_t operator()(const Key &key) const {
+         return ((size_t) key.type * 1000003u + (size_t) key.left) * 1000003u + (size_t) key.right;
+      }
+   };
+   std::vector<ExprPtr> nodes;
+   std::unordered_map<Key, ExprPtr, KeyHash> table;
+   std::unordered_map<std::string, ExprPtr> vars;
+   template <typename T, typename... Args>
+   ExprPtr add(Args&&... args) {
+      ExprPtr expr = std::allocate_shared<T>(ArenaAllocator<T>(&arena), std::forward<Args>(args)...);
+      expr->id = nodes.size();
+      nodes.push_back(expr);
+      return expr;
+   }
+ public:
+   ExprFactory() : arena(4 << 10) {}
+   ExprPtr make_true();
+   ExprPtr make_var(const std::string &var, int ap_id = -1);
+   ExprPtr make_unary(ExprType type, const ExprPtr &expr);
+   ExprPtr make_binary(ExprType type, const ExprPtr &left, const ExprPtr &right);
+   int size() const { return nodes.size(); }
+   ExprPtr get(int id) const { return nodes[id]; }
+};
+
+// The factory of the innermost ExprScope of the thread, or else a factory
+// that lives as long as the thread
+ExprFactory& GetExprFactory();
+
+// While a scope lives, GetExprFactory on its thread returns a factory of its
+// own, so the expressions of one query are made in one arena and freed at
+// once when the scope ends. No expression made in the scope may outlive it.
+class ExprScope {
+ private:
+   ExprFactory factory;
+   ExprFactory *outer;
+ public:
+   ExprScope();
+   ExprScope(const ExprScope &scope) = delete;
+   ~ExprScope();
+};
+
+bool ExprEqual(const ExprPtr &expr1, const ExprPtr &expr2);
+ExprPtr ExprCalcNeg(const ExprPtr &expr);
+ExprPtr ExprSimplify(const ExprPtr &expr);
+std::string ExprCanonical(const ExprPtr &expr);
+bool ExprHasNext(const ExprPtr &expr);
 
+// A set of expressions, indexed by expression id
 class ExprSet {
  protected :
    std::vector<ExprPtr> exprs;
+   std::unordered_map<int, int> index;
  public:
    ExprSet() {}
-   ExprSet(const ExprSet &exprset) : exprs(exprset.exprs) {}
+   ExprSet(const ExprSet &exprset) : exprs(exprset.exprs), index(exprset.index) {}
    ExprSet copy() { return ExprSet(*this); }
    std::vector<ExprPtr>& get_exprs() { return exprs; }
-   bool contains(ExprPtr expr) {
-      for (auto &e : exprs) {
-         if (ExprEqual(e, expr)) return true;
-      }
-      return false;
+   bool contains(const ExprPtr &expr) const {
+      return index.find(expr->get_id()) != index.end();
    }
-   void add(ExprPtr expr) { exprs.push_back(expr); }
-};
-
-class Elementary : public ExprSet {
- public:
-   Elementary() {}
-   Elementary(const Elementary &elementary) : ExprSet(elementary) {}
-   Elementary(const ExprSet &exprset) : ExprSet(exprset) {}
-   std::set<std::string> get_ap() {
-      std::set<std::string> ap;
-      for (auto &e : exprs) {
-         if (e->get_type() == ExprType::VAR) {
-            VarExprPtr var_expr = std::dynamic_pointer_cast<VarExpr>(e);
-            ap.insert(var_expr->get_var());
-         }
-      }
-      return ap;
+   void add(const ExprPtr &expr) {
+      if (contains(expr)) return;
+      index[expr->get_id()] = exprs.size();
+      exprs.push_back(expr);
+   }
+   void remove_last() {
+      index.erase(exprs.back()->get_id());
+      exprs.pop_back();
    }
 };
 
+// The closure numbers its expressions 0 .. size() - 1. For every expression
+// the closure index of its negation and of its operands is precomputed, so
+// the elementary-set checks and the GNBA construction only compare indices.
 class Closure : public ExprSet {
  private:
    ExprPtr primary;
-   std::map<ExprPtr, ExprPtr> negation;
-   void build_closure(ExprPtr expr);
+   std::vector<int> negation;
+   std::vector<int> left, right;
+   void build_closure(const ExprPtr &expr);
+   void build_operands();
       
  public:
-   Closure(ExprPtr primary) : primary(primary) { build_closure(primary); }
+   Closure(ExprPtr primary) : primary(primary) { 
+      build_closure(primary); 
+      build_operands();
+   }
    int size() { return get_exprs().size(); }
    ExprPtr get_ith(int i) { return get_exprs()[i]; }
-   ExprPtr get_negation(ExprPtr expr) { return negation[expr]; }
-   int get_id(ExprPtr expr) { 
-      for (std::vector<ExprPtr>::size_type i = 0; i < get_exprs().size(); ++i) {
-         if (ExprEqual(get_exprs()[i], expr)) return i;
-      }
-      return -1;
+   ExprPtr get_negation(const ExprPtr &expr) { return get_ith(negation[get_id(expr)]); }
+   int get_id(const ExprPtr &expr) { 
+      auto it = index.find(expr->get_id());
+      return it == index.end() ? -1 : it->second;
    }
-   bool contains(ExprPtr expr) {
-      for (auto &e : get_exprs()) {
-         if (ExprEqual(e, expr)) return true;
-      }
-      return false;
-   }
-   void add(ExprPtr expr, ExprPtr neg) {  
+   int get_negation_id(int i) { return negation[i]; }
+   // Closure index of the operand of a unary expression / the left operand
+   // of a binary expression, -1 otherwise
+   int get_left_id(int i) { return left[i]; }
+   int get_right_id(int i) { return right[i]; }
+   void add(const ExprPtr &expr, const ExprPtr &neg) {  
       ExprSet::add(expr);
-      negation[expr] = neg;
       ExprSet::add(neg);
-      negation[neg] = expr;
+      negation.push_back(negation.size() + 1);
+      negation.push_back(negation.size() - 1);
    }
    ExprPtr& get_primary() { return primary; }
    void print_closure() {
-      for (auto &e : get_exprs()) {
-         std::cout << *e << ", with negation: " << *negation[e] << std::endl;
+      for (int i = 0; i < size(); ++i) {
+         std::cout << *get_ith(i) << ", with negation: " << *get_ith(negation[i]) << std::endl;
       }
    }
 };
 
+// An elementary set is a bitset over closure indices
+typedef Bitset Elementary;
+
 class ElementarySet {
  private:
    std::shared_ptr<Closure> closure;
    std::vector<Elementary> elementaries;
+   std::vector<APMask> aps;
+   // closure indices of the non-negated expressions, operands first
+   std::vector<int> order;
 
-   void build_elementary_helper(std::shared_ptr<Closure> closure, int pos, ExprSet &elementary);
+   void build_elementary_helper(std::shared_ptr<Closure> closure, int pos, Elementary &elementary);
    void build_elementary(std::shared_ptr<Closure> closure);
 
  public:
    ElementarySet(std::shared_ptr<Closure> closure) { build_elementary(closure); }
    std::shared_ptr<Closure> get_closure() { return closure; }
    std::vector<Elementary>& get_elementaries() { return elementaries; }
+   // The atomic propositions in the i-th elementary set
+   APMask get_ap(int i) { return aps[i]; }
    void print_elementaries() {
       std::cout << "----------------------------------------\n";
       std::cout << "Elementaries: \n";
       for (auto &e : elementaries) {
          std::cout << "{";
-         for (auto &expr : e.get_exprs()) {
-            std::cout << *expr;
-            if (expr != e.get_exprs().back()) std::cout << ", ";
-            else std::cout << "}\n";
+         bool first = true;
+         for (int i = 0; i < closure->size(); ++i) {
+            if (!e.test(i)) continue;
+            if (!first) std::cout << ", ";
+            std::cout << *closure->get_ith(i);
+            first = false;
          }
+         std::cout << "}\n";
       }
       std::cout << "----------------------------------------\n";
    }
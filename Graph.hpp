@@ -0,0 +1,166 @@
+#ifndef GRAPH_HPP
+#define GRAPH_HPP
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+// A contiguous range of successor ids
+class EdgeRange {
+ private:
+   const int *first;
+   const int *last;
+ public:
+   EdgeRange(const int *first, const int *last) : first(first), last(last) {}
+   const int* begin() const {
+      return first;
+   }
+   const int* end() const {
+      return last;
+   }
+   int size() const {
+      return last - first;
+   }
+   int operator[](int i) const {
+      return first[i];
+   }
+};
+
+// Immutable directed graph in compressed sparse row form.
+// The successors of node i are targets[offsets[i]] .. targets[offsets[i + 1] - 1],
+// sorted and without duplicates.
+// The arrays are either owned by the graph or a view into memory kept alive
+// by storage, such as a mapped file, so a graph can be used without copying.
+class Graph {
+ private:
+   std::vector<int> own_offsets;
+   std::vector<int> own_targets;
+   std::shared_ptr<const void> storage;
+   int node_count;
+   int edge_count;
+   const int *offsets;
+   const int *targets;
+ public:
+   Graph() : own_offsets(1, 0), node_count(0), edge_count(0), offsets(own_offsets.data()), targets(nullptr) {}
+   Graph(std::vector<int> offsets, std::vector<int> targets)
+      : own_offsets(std::move(offsets)), own_targets(std::move(targets)),
+        node_count(own_offsets.size() - 1), edge_count(own_targets.size()),
+        offsets(own_offsets.data()), targets(own_targets.data()) {}
+   Graph(int node_count, int edge_count, const int *offsets, const int *targets, std::shared_ptr<const void> storage)
+      : storage(storage), node_count(node_count), edge_count(edge_count), offsets(offsets), targets(targets) {}
+   Graph(const Graph &) = delete;
+   Graph& operator=(const Graph &) = delete;
+   int get_node_count() const {
+      return node_count;
+   }
+   int get_edge_count() const {
+      return edge_count;
+   }
+   // node_count + 1 offsets
+   const int* get_offsets() const {
+      return offsets;
+   }
+   const int* get_targets() const {
+      return targets;
+   }
+   EdgeRange get_successors(int node) const {
+      return EdgeRange(targets + offsets[node], targets + offsets[node + 1]);
+   }
+   bool has_edge(int from, int to) const {
+      EdgeRange range = get_successors(from);
+      return std::binary_search(range.begin(), range.end(), to);
+   }
+};
+
+typedef std::shared_ptr<const Graph> GraphPtr;
+
+// Collects edges in any order and packs them into a Graph
+class GraphBuilder {
+ private:
+   int node_count;
+   std::vector<std::pair<int, int>> edges;
+   std::vector<int> labels;
+ public:
+   GraphBuilder(int node_count) : node_count(node_count) {}
+   void add_edge(int from, int to) {
+      edges.push_back(std::make_pair(from, to));
+   }
+   // Either all edges have a label or none
+   void add_edge(int from, int to, int label) {
+      edges.push_back(std::make_pair(from, to));
+      labels.push_back(label);
+   }
+   // Like build, and put the distinct labels of the edges merged into the
+   // e-th edge of the graph into row e of label_graph
+   GraphPtr build(GraphPtr &label_graph) {
+      std::vector<int> offsets(node_count + 1, 0);
+      for (auto &e : edges) {
+         ++offsets[e.first + 1];
+      }
+      for (int i = 0; i < node_count; ++i) {
+         offsets[i + 1] += offsets[i];
+      }
+      // (target, label) of every edge, bucketed by source
+      std::vector<std::pair<int, int>> rows(edges.size());
+      std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t k = 0; k < edges.size(); ++k) {
+         rows[fill[edges[k].first]++] = std::make_pair(edges[k].second, labels[k]);
+      }
+      std::vector<int> targets, label_offsets(1, 0), label_targets;
+      targets.reserve(rows.size());
+      label_offsets.reserve(rows.size() + 1);
+      label_targets.reserve(rows.size());
+      for (int i = 0; i < node_count; ++i) {
+         int begin = offsets[i];
+         std::sort(rows.begin() + begin, rows.begin() + offsets[i + 1]);
+         offsets[i] = targets.size();
+         for (int j = begin; j < offsets[i + 1]; ++j) {
+            if (j == begin || rows[j].first != rows[j - 1].first) {
+               targets.push_back(rows[j].first);
+               label_offsets.push_back(label_offsets.back());
+            }
+            if (j == begin || rows[j] != rows[j - 1]) {
+               label_targets.push_back(rows[j].second);
+               ++label_offsets.back();
+            }
+         }
+      }
+      offsets[node_count] = targets.size();
+      edges.clear();
+      labels.clear();
+      label_graph = std::make_shared<const Graph>(std::move(label_offsets), std::move(label_targets));
+      return std::make_shared<const Graph>(std::move(offsets), std::move(targets));
+   }
+   // Bucket the edges by source, then sort and deduplicate every row in place
+   GraphPtr build() {
+      std::vector<int> offsets(node_count + 1, 0);
+      for (auto &e : edges) {
+         ++offsets[e.first + 1];
+      }
+      for (int i = 0; i < node_count; ++i) {
+         offsets[i + 1] += offsets[i];
+      }
+      std::vector<int> targets(edges.size());
+      std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+      for (auto &e : edges) {
+         targets[fill[e.first]++] = e.second;
+      }
+      int size = 0;
+      for (int i = 0; i < node_count; ++i) {
+         int begin = offsets[i];
+         std::sort(targets.begin() + begin, targets.begin() + offsets[i + 1]);
+         int end = std::unique(targets.begin() + begin, targets.begin() + offsets[i + 1]) - targets.begin();
+         offsets[i] = size;
+         for (int j = begin; j < end; ++j) {
+            targets[size++] = targets[j];
+         }
+      }
+      offsets[node_count] = size;
+      targets.resize(size);
+      edges.clear();
+      return std::make_shared<const Graph>(std::move(offsets), std::move(targets));
+   }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef GUARD_HPP
+#define GUARD_HPP
+
+#include <vector>
+#include <algorithm>
+#include "AP.hpp"
+
+// A conjunction of literals: the APs in care must have the values given by
+// ap, the other APs may have any value
+struct Cube {
+   APMask ap;
+   APMask care;
+   Cube() : ap(0), care(0) {}
+   Cube(APMask ap, APMask care) : ap(ap & care), care(care) {}
+   // Every label matching this cube also matches other
+   bool implies(const Cube &other) const {
+      return (other.care & ~care) == 0 && APEqual(ap, other.ap, other.care);
+   }
+   bool operator==(const Cube &other) const {
+      return ap == other.ap && care == other.care;
+   }
+   bool operator<(const Cube &other) const {
+      return care != other.care ? care < other.care : ap < other.ap;
+   }
+};
+
+// The propositional condition of an automaton transition, a disjunction of
+// cubes. The cubes are kept sorted, and cubes implied by another cube or
+// differing from another one in a single literal are merged, so equal
+// guards built in different orders usually compare equal.
+class Guard {
+ private:
+   std::vector<Cube> cubes;
+   void simplify() {
+      bool changed = true;
+      while (changed) {
+         changed = false;
+         for (size_t i = 0; i < cubes.size() && !changed; ++i) {
+            for (size_t j = 0; j < cubes.size() && !changed; ++j) {
+               if (i == j) continue;
+               if (cubes[i].implies(cubes[j])) {
+                  cubes.erase(cubes.begin() + i);
+                  changed = true;
+               } else if (cubes[i].care == cubes[j].care &&
+                          __builtin_popcountll(cubes[i].ap ^ cubes[j].ap) == 1) {
+                  // a & x | a & !x = a
+                  cubes[j] = Cube(cubes[j].ap, cubes[j].care & ~(cubes[i].ap ^ cubes[j].ap));
+                  cubes.erase(cubes.begin() + i);
+                  changed = true;
+               }
+            }
+         }
+      }
+      std::sort(cubes.begin(), cubes.end());
+   }
+ public:
+   Guard() {}
+   Guard(const Cube &cube) : cubes(1, cube) {}
+   const std::vector<Cube>& get_cubes() const {
+      return cubes;
+   }
+   // The APs some cube constrains
+   APMask get_care() const {
+      APMask care = 0;
+      for (auto &cube : cubes) {
+         care |= cube.care;
+      }
+      return care;
+   }
+   // Disjunction with other
+   void add(const Guard &other) {
+      cubes.insert(cubes.end(), other.cubes.begin(), other.cubes.end());
+      simplify();
+   }
+   // Whether a label matches the guard, looking only at the APs in scope
+   bool holds(APMask label, APMask scope) const {
+      for (auto &cube : cubes) {
+         if (APEqual(cube.ap, label, cube.care & scope)) return true;
+      }
+      return false;
+   }
+   // A sufficient test for implication: every cube implies a cube of other
+   bool implies(const Guard &other) const {
+      for (auto &cube : cubes) {
+         bool found = false;
+         for (auto &c : other.cubes) {
+            if (cube.implies(c)) {
+               found = true;
+               break;
+            }
+         }
+         if (!found) return false;
+      }
+      return true;
+   }
+   bool operator==(const Guard &other) const {
+      return cubes == other.cubes;
+   }
+   bool operator<(const Guard &other) const {
+      return cubes < other.cubes;
+   }
+};
+
+// Print a guard as cubes of AP ids, ! marks a negated AP
+inline std::ostream& PrintGuard(std::ostream &os, const Guard &guard) {
+   if (guard.get_cubes().empty()) return os << "false";
+   bool first_cube = true;
+   for (auto &cube : guard.get_cubes()) {
+      if (!first_cube) os << " | ";
+      first_cube = false;
+      if (cube.care == 0) {
+         os << "true";
+         continue;
+      }
+      bool first = true;
+      for (int i = 0; i < MAX_AP; ++i) {
+         if (!(cube.care & APBit(i))) continue;
+         if (!first) os << "&";
+         os << ((cube.ap & APBit(i)) ? "" : "!") << i;
+         first = false;
+      }
+   }
+   return os;
+}
+
+#endif
@@ -3,59 +3,63 @@
 // Convert an LTL formula to a GNBA
 std::shared_ptr<GNBA> LTL_to_GNBA(std::shared_ptr<ElementarySet> elementaries) {
    std::shared_ptr<GNBA> gnba = std::make_shared<GNBA>();
-   ExprPtr phi = elementaries->get_closure()->get_primary();
+   std::shared_ptr<Closure> closure = elementaries->get_closure();
+   std::vector<Elementary> &sets = elementaries->get_elementaries();
+   int phi = closure->get_id(closure->get_primary());
+   std::vector<int> nexts, untils;
+   for (int k = 0; k < closure->size(); ++k) {
+      if (closure->get_ith(k)->get_type() == ExprType::NEXT) nexts.push_back(k);
+      if (closure->get_ith(k)->get_type() == ExprType::UNTIL) untils.push_back(k);
+   }
+   // every elementary set fixes the value of all APs of the formula
+   APMask care = 0;
+   for (int k = 0; k < closure->size(); ++k) {
+      if (closure->get_ith(k)->get_type() == ExprType::VAR) {
+         VarExpr &var_expr = static_cast<VarExpr&>(*closure->get_ith(k));
+         if (var_expr.get_ap_id() >= 0) care |= APBit(var_expr.get_ap_id());
+      }
+   }
    int id = 0;
-   for (auto &e : elementaries->get_elementaries()) {
-      int initial = e.contains(phi) ? 1 : 0;
-      gnba->add_node(std::make_shared<NBANode>(id++, initial, e.get_ap()));
+   for (auto &e : sets) {
+      gnba->add_node(id, e.test(phi) ? 1 : 0);
+      ++id;
    }
-   for (std::vector<Elementary>::size_type i = 0; i < elementaries->get_elementaries().size(); ++i) {
-      for (std::vector<Elementary>::size_type j = 0; j < elementaries->get_elementaries().size(); ++j) {
+   for (std::vector<Elementary>::size_type i = 0; i < sets.size(); ++i) {
+      for (std::vector<Elementary>::size_type j = 0; j < sets.size(); ++j) {
          bool flag = true;
-         NBANodePtr from = gnba->get_node(i);
-         NBANodePtr to = gnba->get_node(j);
-         for (auto &expr : elementaries->get_closure()->get_exprs()) {
-            if (expr->get_type() == ExprType::NEXT) {
-               ExprPtr next = std::dynamic_pointer_cast<UnaryExpr>(expr)->get_expr();
-               bool flag1 = elementaries->get_elementaries()[i].contains(expr);
-               bool flag2 = elementaries->get_elementaries()[j].contains(next);
-               if (flag1 != flag2) {
-                  flag = false;
-                  break;
-               }
+         for (auto &k : nexts) {
+            bool flag1 = sets[i].test(k);
+            bool flag2 = sets[j].test(closure->get_left_id(k));
+            if (flag1 != flag2) {
+               flag = false;
+               break;
             }
          }
          if (!flag) continue;
-         for (auto &expr : elementaries->get_closure()->get_exprs()) {
-            if (expr->get_type() == ExprType::UNTIL) {
-               ExprPtr left = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_left();
-               ExprPtr right = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_right();
-               bool flag1 = elementaries->get_elementaries()[i].contains(expr);
-               bool flag2 = elementaries->get_elementaries()[i].contains(right) || 
-                            (elementaries->get_elementaries()[i].contains(left) && elementaries->get_elementaries()[j].contains(expr));
-               if (flag1 != flag2) {
-                  flag = false;
-                  break;
-               }
+         for (auto &k : untils) {
+            int left = closure->get_left_id(k), right = closure->get_right_id(k);
+            bool flag1 = sets[i].test(k);
+            bool flag2 = sets[i].test(right) || (sets[i].test(left) && sets[j].test(k));
+            if (flag1 != flag2) {
+               flag = false;
+               break;
             }
          }
+         // a state reads the APs of its elementary set when it is left
          if (flag) {
-            gnba->add_transition(i, j);
+            gnba->add_transition(i, j, Guard(Cube(elementaries->get_ap(i), care)));
          }
       }
    }
-   for (auto &expr : elementaries->get_closure()->get_exprs()) {
-      if (expr->get_type() == ExprType::UNTIL) {
-         ExprPtr left = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_left();
-         ExprPtr right = std::dynamic_pointer_cast<BinaryExpr>(expr)->get_right();
-         std::set<int> accepting;
-         for (std::vector<Elementary>::size_type i = 0; i < elementaries->get_elementaries().size(); ++i) {
-            if (elementaries->get_elementaries()[i].contains(right) || !elementaries->get_elementaries()[i].contains(expr)) {
-               accepting.insert(i);
-            }
+   for (auto &k : untils) {
+      int right = closure->get_right_id(k);
+      std::set<int> accepting;
+      for (std::vector<Elementary>::size_type i = 0; i < sets.size(); ++i) {
+         if (sets[i].test(right) || !sets[i].test(k)) {
+            accepting.insert(i);
          }
-         gnba->add_accepting(accepting);
       }
+      gnba->add_accepting(accepting);
    }
    if (gnba->get_accepting().empty()) {
       std::set<int> accepting;
@@ -67,18 +71,16 @@ std::shared_ptr<GNBA> LTL_to_GNBA(std::shared_ptr<ElementarySet> elementaries) {
    return gnba;
 }
 
-// Convert a GNBA to an NBA
+// Convert a GNBA to an NBA with one copy per acceptance set. A run leaves
+// copy j after it passes a state of the j-th set, and the accepting states
+// are those of the first set in the first copy.
 std::shared_ptr<NBA> GNBA_to_NBA(std::shared_ptr<GNBA> gnba) {
    std::shared_ptr<NBA> nba = std::make_shared<NBA>();
    std::vector<std::vector<NBANodePtr>> nodes(gnba->get_node_count());
    int id = 0;
    for (int i = 0; i < gnba->get_node_count(); ++i) {
       for (std::vector<std::set<int>>::size_type j = 0; j < gnba->get_accepting().size(); ++j) {
-         NBANodePtr node = std::make_shared<NBANode>(id++, 
-                                                     (j == 0) && gnba->get_node(i)->get_is_initial(), 
-                                                     gnba->get_node(i)->get_ap());
-         nodes[i].push_back(node);
-         nba->add_node(node);
+         nodes[i].push_back(nba->add_node(id++, (j == 0) && gnba->get_node(i)->get_is_initial()));
       }
    }
    for (auto &node : gnba->get_accepting()[0]) {
@@ -87,10 +89,10 @@ std::shared_ptr<NBA> GNBA_to_NBA(std::shared_ptr<GNBA> gnba) {
    for (int i = 0; i < gnba->get_node_count(); ++i) {
       for (std::vector<std::set<int>>::size_type j = 0; j < gnba->get_accepting().size(); ++j) {
          for (auto & e : gnba->get_node(i)->get_transition()) {
-            if (gnba->get_accepting()[j].find(e) == gnba->get_accepting()[j].end()) {
-               nba->add_transition(nodes[i][j]->get_id(), nodes[e][j]->get_id());
+            if (gnba->get_accepting()[j].find(i) == gnba->get_accepting()[j].end()) {
+               nba->add_transition(nodes[i][j]->get_id(), nodes[e.first][j]->get_id(), e.second);
             } else {
-               nba->add_transition(nodes[i][j]->get_id(), nodes[e][(j + 1) % gnba->get_accepting().size()]->get_id());
+               nba->add_transition(nodes[i][j]->get_id(), nodes[e.first][(j + 1) % gnba->get_accepting().size()]->get_id(), e.second);
             }
          }
       }
@@ -2,17 +2,23 @@
 #define NBA_HPP
 
 #include "Expr.hpp"
+#include "Arena.hpp"
+#include "Guard.hpp"
 
+// target -> guard, allocated in the arena of the automaton
+typedef std::map<int, Guard, std::less<int>, ArenaAllocator<std::pair<const int, Guard>>> TransitionMap;
+
+// The transitions are labelled: a transition can be taken when the label
+// of the current letter matches its guard
 class NBANode {
  private:
    int id;
    int is_initial;
    int is_accepting;
-   std::set<std::string> ap;
-   std::set<int> transition;
+   TransitionMap transition;
  public:
-   NBANode() : id(0), is_initial(0), is_accepting(0) {}
-   NBANode(int id, int is_initial, const std::set<std::string> &ap) : id(id), is_initial(is_initial), is_accepting(0), ap(ap) {}
+   NBANode(int id, int is_initial, Arena *arena)
+      : id(id), is_initial(is_initial), is_accepting(0), transition(ArenaAllocator<TransitionMap::value_type>(arena)) {}
    int get_id() const {
       return id;
    }
@@ -25,59 +31,97 @@ class NBANode {
    void set_is_accepting(int is_accepting) {
       this->is_accepting = is_accepting;
    }
-   std::set<std::string>& get_ap() {
-      return ap;
-   }
-   std::set<int>& get_transition() {
+   TransitionMap& get_transition() {
       return transition;
    }
 };
 
 typedef std::shared_ptr<NBANode> NBANodePtr;
 
+// The acceptance sets a state belongs to, one bit per set
+typedef uint64_t AcceptMask;
+
+const int MAX_ACCEPTING_SETS = 64;
+
+// The nodes of an automaton, their transitions and the node map are
+// allocated in one arena, which goes away with the last copy of the
+// automaton. An intermediate automaton of the translation is thus freed in a
+// few large blocks rather than node by node.
 class NBA_base {
  protected:
+   // declared first, so everything in it is released before it
+   std::shared_ptr<Arena> arena;
    int node_count;
    std::vector<int> initial;
-   std::set<std::string> aps;
+   APMask aps;
+   // translated from a formula without X, so the language is closed under
+   // stuttering and partial-order reduction applies
+   bool next_free;
    std::vector<NBANodePtr> nodes;
-   std::map<int, NBANodePtr> node_map;
+   std::map<int, NBANodePtr, std::less<int>, ArenaAllocator<std::pair<const int, NBANodePtr>>> node_map;
  public:
-   NBA_base() : node_count(0) {}
-   NBA_base(int node_count) : node_count(node_count) {}
-   void add_node(NBANodePtr node) {
+   NBA_base() : NBA_base(0) {}
+   NBA_base(int node_count)
+      : arena(std::make_shared<Arena>()), node_count(node_count), aps(0), next_free(false),
+        node_map(ArenaAllocator<std::pair<const int, NBANodePtr>>(arena.get())) {}
+   NBANodePtr add_node(int id, int is_initial) {
+      NBANodePtr node = std::allocate_shared<NBANode>(ArenaAllocator<NBANode>(arena.get()), id, is_initial,
+                                                      arena.get());
       nodes.push_back(node);
       node_map[node->get_id()] = node;
       if (node->get_is_initial()) {
          initial.push_back(node->get_id());
       }
       ++node_count;
-      for (auto & ap : node->get_ap()) {
-         aps.insert(ap);
+      return node;
+   }
+   // Adding a transition that exists already extends its guard
+   void add_transition(int from, int to, const Guard &guard) {
+      TransitionMap &transition = node_map[from]->get_transition();
+      auto it = transition.find(to);
+      if (it == transition.end()) {
+         transition[to] = guard;
+      } else {
+         it->second.add(guard);
       }
-   }
-   void add_transition(int from, int to) {
-      node_map[from]->get_transition().insert(to);
+      aps |= guard.get_care();
    }
    int get_node_count() const {
       return node_count;
    }
+   int get_edge_count() const {
+      int count = 0;
+      for (auto &node : nodes) {
+         count += node->get_transition().size();
+      }
+      return count;
+   }
    std::vector<int>& get_initial() {
       return initial;
    }
-   std::set<std::string>& get_ap() {
+   APMask get_ap() const {
       return aps;
    }
+   bool is_next_free() const {
+      return next_free;
+   }
+   void set_next_free(bool next_free) {
+      this->next_free = next_free;
+   }
    NBANodePtr get_node(int id) const {
       return node_map.at(id);
    }
+   // A run is accepting iff it visits every acceptance set infinitely often
+   virtual int get_accepting_set_count() const = 0;
+   virtual AcceptMask get_acceptance(int id) const = 0;
+   AcceptMask get_full_acceptance() const {
+      int sets = get_accepting_set_count();
+      return sets >= MAX_ACCEPTING_SETS ? ~(AcceptMask) 0 : (((AcceptMask) 1) << sets) - 1;
+   }
+   virtual ~NBA_base() {}
    virtual void print() {
-      std::cout << "AP: {";
-      for (auto &ap : aps) {
-         std::cout << ap;
-         if (ap != *aps.rbegin()) std::cout << ", ";
-      }
-      std::cout << "}\n";
+      std::cout << "AP: ";
+      PrintAPMask(std::cout, aps) << "\n";
       std::cout << "initial: ";
       for (auto &i : initial) {
          std::cout << i << " ";
@@ -85,18 +129,11 @@ class NBA_base {
       std::cout << "\n";
       for (auto &node : nodes) {
          std::cout << "Node " << node->get_id() << "  ";
-         std::cout << "AP: {";
-         for (auto &ap : node->get_ap()) {
-            std::cout << ap;
-            if (ap != *node->get_ap().rbegin()) {
-               std::cout << ", ";
-            }
-         }
-         std::cout << "} ";
          std::cout << "is accepting: " << node->get_is_accepting() << "\n";
          std::cout << "Transition: ";
-         for (auto &to : node->get_transition()) {
-            std::cout << to << " ";
+         for (auto &e : node->get_transition()) {
+            std::cout << e.first << " [";
+            PrintGuard(std::cout, e.second) << "] ";
          }
          std::cout << "\n";
       }
@@ -116,6 +153,12 @@ class NBA : public NBA_base {
    std::set<int>& get_accepting() {
       return accepting;
    }
+   int get_accepting_set_count() const {
+      return 1;
+   }
+   AcceptMask get_acceptance(int id) const {
+      return accepting.count(id) ? 1 : 0;
+   }
    void print() {
       std::cout << "-----------------NBA output begin--------------------\n";
       NBA_base::print();
@@ -140,6 +183,17 @@ class GNBA : public NBA_base {
    std::vector<std::set<int>>& get_accepting() {
       return accepting;
    }
+   int get_accepting_set_count() const {
+      return accepting.size();
+   }
+   // only defined for at most MAX_ACCEPTING_SETS sets
+   AcceptMask get_acceptance(int id) const {
+      AcceptMask mask = 0;
+      for (std::vector<std::set<int>>::size_type i = 0; i < accepting.size(); ++i) {
+         if (accepting[i].count(id)) mask |= ((AcceptMask) 1) << i;
+      }
+      return mask;
+   }
    void print() {
       std::cout << "----------------GNBA output begin--------------------\n";
       NBA_base::print();
@@ -1,49 +1,98 @@
 #include "NestedDFS.hpp"
 
-// Find all nodes reachable from a set of nodes
-std::vector<int> NestedDFSProcessor::reachable_from(std::vector<int> nodes) {
-   std::vector<int> reachable;
-   std::vector<bool> visited(node_count, false);
-   for (std::vector<int>::size_type i = 0; i < nodes.size(); ++i) {
-      if (!visited[nodes[i]]) {
-         std::stack<int> stk;
-         stk.push(nodes[i]);
-         visited[nodes[i]] = true;
-         while (!stk.empty()) {
-            int node = stk.top();
-            stk.pop();
-            reachable.push_back(node);
-            for (std::vector<int>::size_type j = 0; j < edges[node].size(); ++j) {
-               int to = edges[node][j];
-               if (!visited[to]) {
-                  stk.push(to);
-                  visited[to] = true;
-               }
-            }
+// States are created while the product is explored, so the colours have to
+// grow with it
+void NestedDFSProcessor::fit_colour() {
+   if ((int) colour.size() < prod->get_state_count()) {
+      colour.resize(prod->get_state_count(), WHITE);
+   }
+}
+
+// The blue stack is a path from an initial state, and the cycle closes at
+// the state entry on it. The cycle goes up the blue stack from entry, then
+// along the red stack from index red_from, and back to entry.
+void NestedDFSProcessor::make_lasso(int entry, int red_from) {
+   lasso->prefix.clear();
+   lasso->cycle.clear();
+   bool on_cycle = false;
+   for (auto &frame : blue_stack) {
+      on_cycle = on_cycle || frame.first == entry;
+      (on_cycle ? lasso->cycle : lasso->prefix).push_back(frame.first);
+   }
+   for (int i = red_from; i < (int) red_stack.size(); ++i) {
+      lasso->cycle.push_back(red_stack[i].first);
+   }
+}
+
+// Outer search. When all successors of an accepting state are finished, an
+// inner search from it looks for a path back to a state on the outer stack.
+// A cycle is also reported directly when an edge closes a cycle on the outer
+// stack through an accepting state.
+bool NestedDFSProcessor::blue_dfs(int init) {
+   colour[init] = CYAN;
+   blue_stack.push_back(std::make_pair(init, 0));
+   while (!blue_stack.empty()) {
+      int node = blue_stack.back().first;
+      int &next = blue_stack.back().second;
+      if (next < prod->get_successor_count(node)) {
+         int to = prod->get_successor(node, next++);
+         fit_colour();
+         if (colour[to] == CYAN && (prod->is_accepting(node) || prod->is_accepting(to))) {
+            if (lasso) make_lasso(to, 0);
+            return true;
          }
+         if (colour[to] == WHITE) {
+            colour[to] = CYAN;
+            blue_stack.push_back(std::make_pair(to, 0));
+         }
+         continue;
+      }
+      if (prod->is_accepting(node)) {
+         if (red_dfs(node)) return true;
+         colour[node] = RED;
+      } else {
+         colour[node] = BLUE;
       }
+      blue_stack.pop_back();
    }
-   return reachable;
+   return false;
 }
 
-bool NestedDFSProcessor::circle_check_helper(int dest, int current, std::vector<bool> &visited) {
-   for (std::vector<int>::size_type i = 0; i < edges[current].size(); ++i) {
-      int to = edges[current][i];
-      if (to == dest) {
-         return true;
-      }
-      if (!visited[to]) {
-         visited[to] = true;
-         if (circle_check_helper(dest, to, visited)) {
+// Inner search from an accepting state. It only enters states finished by
+// the outer search, and succeeds when it meets a state on the outer stack.
+bool NestedDFSProcessor::red_dfs(int seed) {
+   red_stack.push_back(std::make_pair(seed, 0));
+   while (!red_stack.empty()) {
+      int node = red_stack.back().first;
+      int &next = red_stack.back().second;
+      if (next < prod->get_successor_count(node)) {
+         int to = prod->get_successor(node, next++);
+         if (colour[to] == CYAN) {
+            // the seed is the top of the blue stack, so the red stack goes on from it
+            if (lasso) make_lasso(to, 1);
+            red_stack.clear();
             return true;
          }
+         if (colour[to] == BLUE) {
+            colour[to] = RED;
+            red_stack.push_back(std::make_pair(to, 0));
+         }
+         continue;
       }
+      red_stack.pop_back();
    }
    return false;
 }
 
-bool NestedDFSProcessor::circle_check(int id) {
-   std::vector<bool> visited(node_count, 0);
-   visited[id] = true;
-   return circle_check_helper(id, id, visited);
-}
\ No newline at end of file
+// Search the states reachable from the initial states and stop at the first
+// accepting cycle
+bool NestedDFSProcessor::find_accepting_cycle(Lasso *lasso) {
+   this->lasso = lasso;
+   for (auto &i : prod->get_initial()) {
+      fit_colour();
+      if (colour[i] == WHITE && blue_dfs(i)) {
+         return true;
+      }
+   }
+   return false;
+}
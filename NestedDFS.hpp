@@ -1,25 +1,38 @@
 #ifndef NESTED_DFS_HPP
 #define NESTED_DFS_HPP
 
-#include <set>
-#include <stack>
 #include <vector>
+#include <utility>
+#include "Product.hpp"
 
+// Nested depth-first search for an accepting cycle in the product.
+// The outer (blue) and inner (red) searches share one colour per state, so
+// every state is expanded at most once by each search and the whole check is
+// linear in the size of the explored product. Both searches keep an explicit
+// stack of (state, index of the next successor) frames instead of recursing.
 class NestedDFSProcessor {
  private:
-   int node_count;
-   std::vector<std::vector<int>> edges;
-   std::vector<bool> in_stack;
-   std::stack<int> stk;
-   bool circle_check_helper(int dest, int current, std::vector<bool> &visited);
+   enum Colour : char {
+      WHITE,      // not reached yet
+      CYAN,       // on the stack of the outer search
+      BLUE,       // finished by the outer search
+      RED         // finished by the outer search and reached by an inner search
+   };
+   std::shared_ptr<Product> prod;
+   std::vector<char> colour;
+   std::vector<std::pair<int, int>> blue_stack, red_stack;
+   // filled in when a cycle is found, if not null
+   Lasso *lasso;
+   void fit_colour();
+   void make_lasso(int entry, int red_from);
+   bool blue_dfs(int init);
+   bool red_dfs(int seed);
  public:
-   NestedDFSProcessor(int node_count) : node_count(node_count), edges(node_count) {}
-   void add_edge(int from, int to) {
-      edges[from].push_back(to);
-   }
-   bool circle_check(int id);
-   std::vector<int> reachable_from(std::vector<int>);
+   NestedDFSProcessor(std::shared_ptr<Product> prod) : prod(prod), lasso(nullptr) {}
+   // With a lasso, the accepting run is read off the stacks when the cycle
+   // is found, without searching again
+   bool find_accepting_cycle(Lasso *lasso = nullptr);
 };
 
 
-#endif // NESTED_DFS_HPP
\ No newline at end of file
+#endif // NESTED_DFS_HPP
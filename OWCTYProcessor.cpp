@@ -0,0 +1,197 @@
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+#include "OWCTYProcessor.hpp"
+
+namespace {
+
+// Run f(begin, end) on thread_count slices of [0, n)
+template <typename F>
+void ParallelFor(int thread_count, int n, F f) {
+   if (thread_count <= 1) {
+      f(0, n);
+      return;
+   }
+   std::vector<std::thread> threads;
+   int block = (n + thread_count - 1) / thread_count;
+   for (int begin = 0; begin < n; begin += block) {
+      threads.push_back(std::thread(f, begin, std::min(n, begin + block)));
+   }
+   for (auto &thread : threads) {
+      thread.join();
+   }
+}
+
+// Call visit(v, stack) once for every state pushed, starting with the seeds.
+// visit pushes the states to go on with onto stack. The workers keep their
+// own stacks and hand half of one to the shared frontier when another
+// worker is idle, as in ParallelExplorer.
+template <typename Visit>
+void ParallelTraverse(int thread_count, const std::vector<int> &seeds, Visit visit) {
+   if (thread_count <= 1) {
+      std::vector<int> stack(seeds);
+      while (!stack.empty()) {
+         int v = stack.back();
+         stack.pop_back();
+         visit(v, stack);
+      }
+      return;
+   }
+   const size_t BATCH = 64;
+   std::mutex lock;
+   std::condition_variable wake;
+   std::vector<int> frontier(seeds);
+   int active = 0;
+   std::atomic<int> idle(0);
+   auto work = [&]() {
+      std::vector<int> stack;
+      std::unique_lock<std::mutex> guard(lock);
+      while (true) {
+         if (!stack.empty()) {
+            guard.unlock();
+            while (!stack.empty()) {
+               int v = stack.back();
+               stack.pop_back();
+               visit(v, stack);
+               if (idle.load(std::memory_order_relaxed) > 0 && stack.size() > 1) break;
+            }
+            guard.lock();
+            if (idle.load(std::memory_order_relaxed) > 0 && stack.size() > 1) {
+               size_t half = stack.size() / 2;
+               frontier.insert(frontier.end(), stack.begin(), stack.begin() + half);
+               stack.erase(stack.begin(), stack.begin() + half);
+               wake.notify_all();
+            }
+            if (stack.empty() && --active == 0 && frontier.empty()) {
+               wake.notify_all();
+            }
+            continue;
+         }
+         if (!frontier.empty()) {
+            size_t take = std::min(BATCH, frontier.size());
+            stack.assign(frontier.end() - take, frontier.end());
+            frontier.resize(frontier.size() - take);
+            ++active;
+            continue;
+         }
+         if (active == 0) {
+            wake.notify_all();
+            return;
+         }
+         idle.fetch_add(1, std::memory_order_relaxed);
+         wake.wait(guard);
+         idle.fetch_sub(1, std::memory_order_relaxed);
+      }
+   };
+   std::vector<std::thread> threads;
+   for (int i = 0; i < thread_count; ++i) {
+      threads.push_back(std::thread(work));
+   }
+   for (auto &thread : threads) {
+      thread.join();
+   }
+}
+
+}
+
+// States not expanded yet are expanded here, one thread at a time, so the
+// sweeps below only read the product
+OWCTYProcessor::OWCTYProcessor(std::shared_ptr<Product> prod, int thread_count)
+   : prod(prod), thread_count(std::max(1, thread_count)) {
+   for (int v = 0; v < prod->get_state_count(); ++v) {
+      prod->get_successor_count(v);
+   }
+   state_count = prod->get_state_count();
+   in_set = std::vector<std::atomic<char>>(state_count);
+   reached = std::vector<std::atomic<char>>(state_count);
+   in_degree = std::vector<std::atomic<int>>(state_count);
+}
+
+void OWCTYProcessor::reset(int set) {
+   AcceptMask bit = ((AcceptMask) 1) << set;
+   std::vector<int> seeds;
+   for (int v = 0; v < state_count; ++v) {
+      bool seed = in_set[v].load(std::memory_order_relaxed) && (prod->get_acceptance(v) & bit);
+      reached[v].store(seed, std::memory_order_relaxed);
+      if (seed) seeds.push_back(v);
+   }
+   ParallelTraverse(thread_count, seeds, [&](int v, std::vector<int> &stack) {
+      for (int i = 0; i < prod->get_successor_count(v); ++i) {
+         int w = prod->get_successor(v, i);
+         if (!in_set[w].load(std::memory_order_relaxed)) continue;
+         char expected = 0;
+         if (reached[w].compare_exchange_strong(expected, 1, std::memory_order_relaxed)) {
+            stack.push_back(w);
+         }
+      }
+   });
+   ParallelFor(thread_count, state_count, [&](int begin, int end) {
+      for (int v = begin; v < end; ++v) {
+         if (!reached[v].load(std::memory_order_relaxed)) in_set[v].store(0, std::memory_order_relaxed);
+      }
+   });
+}
+
+// A state is removed when its last predecessor in the set is removed, so
+// every state is pushed at most once
+void OWCTYProcessor::eliminate() {
+   ParallelFor(thread_count, state_count, [&](int begin, int end) {
+      for (int v = begin; v < end; ++v) {
+         in_degree[v].store(0, std::memory_order_relaxed);
+      }
+   });
+   ParallelFor(thread_count, state_count, [&](int begin, int end) {
+      for (int v = begin; v < end; ++v) {
+         if (!in_set[v].load(std::memory_order_relaxed)) continue;
+         for (int i = 0; i < prod->get_successor_count(v); ++i) {
+            int w = prod->get_successor(v, i);
+            if (in_set[w].load(std::memory_order_relaxed)) in_degree[w].fetch_add(1, std::memory_order_relaxed);
+         }
+      }
+   });
+   std::vector<int> seeds;
+   for (int v = 0; v < state_count; ++v) {
+      if (in_set[v].load(std::memory_order_relaxed) && in_degree[v].load(std::memory_order_relaxed) == 0) {
+         seeds.push_back(v);
+      }
+   }
+   ParallelTraverse(thread_count, seeds, [&](int v, std::vector<int> &stack) {
+      in_set[v].store(0, std::memory_order_relaxed);
+      for (int i = 0; i < prod->get_successor_count(v); ++i) {
+         int w = prod->get_successor(v, i);
+         if (in_set[w].load(std::memory_order_relaxed) && in_degree[w].fetch_sub(1, std::memory_order_relaxed) == 1) {
+            stack.push_back(w);
+         }
+      }
+   });
+}
+
+int OWCTYProcessor::count_set() {
+   int count = 0;
+   for (int v = 0; v < state_count; ++v) {
+      count += in_set[v].load(std::memory_order_relaxed);
+   }
+   return count;
+}
+
+bool OWCTYProcessor::find_accepting_scc() {
+   for (int v = 0; v < state_count; ++v) {
+      in_set[v].store(1, std::memory_order_relaxed);
+   }
+   int sets = 0;
+   while (sets < MAX_ACCEPTING_SETS && (prod->get_full_acceptance() >> sets & 1)) {
+      ++sets;
+   }
+   int count = state_count;
+   while (count > 0) {
+      for (int set = 0; set < sets; ++set) {
+         reset(set);
+      }
+      eliminate();
+      int next = count_set();
+      if (next == count) break;
+      count = next;
+   }
+   return count > 0;
+}
@@ -0,0 +1,34 @@
+#ifndef OWCTY_PROCESSOR_HPP
+#define OWCTY_PROCESSOR_HPP
+
+#include <atomic>
+#include <vector>
+#include "Product.hpp"
+
+// Parallel emptiness check by One Way Catch Them Young (Cerna, Pelanek).
+// Starting from all states of the product, it repeats two steps until the
+// set S of candidate states stops shrinking:
+//  - reset: for every acceptance set F, keep the states of S reachable
+//    within S from a state of S in F
+//  - elimination: remove the states of S without a predecessor in S
+// Every state of the final S lies on or after an accepting cycle, so an
+// accepting cycle exists iff S is not empty. Unlike a DFS, both steps are
+// plain graph sweeps that many threads can share.
+// The whole product is expanded first, best with a ParallelExplorer.
+class OWCTYProcessor {
+ private:
+   std::shared_ptr<Product> prod;
+   int thread_count;
+   int state_count;
+   std::vector<std::atomic<char>> in_set;
+   std::vector<std::atomic<char>> reached;
+   std::vector<std::atomic<int>> in_degree;
+   void reset(int set);
+   void eliminate();
+   int count_set();
+ public:
+   OWCTYProcessor(std::shared_ptr<Product> prod, int thread_count);
+   bool find_accepting_scc();
+};
+
+#endif
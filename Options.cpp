@@ -0,0 +1,111 @@
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include "Options.hpp"
+
+// A byte count with an optional K, M or G suffix, 0 if malformed
+static uint64_t ParseSize(const std::string &text) {
+   char *end;
+   uint64_t size = std::strtoull(text.c_str(), &end, 10);
+   std::string suffix(end);
+   if (suffix == "K" || suffix == "k") return size << 10;
+   if (suffix == "M" || suffix == "m") return size << 20;
+   if (suffix == "G" || suffix == "g") return size << 30;
+   return suffix.empty() ? size : 0;
+}
+
+// A whole decimal number, false if malformed or out of int range
+static bool ParseCount(const std::string &text, int &count) {
+   char *end;
+   errno = 0;
+   long value = std::strtol(text.c_str(), &end, 10);
+   if (text.empty() || *end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) return false;
+   count = value;
+   return true;
+}
+
+static void PrintUsage(const char *program) {
+   std::cerr << "usage: " << program << " [options] [TS file] [LTL file]\n"
+             << "  --threads N          check formulas with N worker threads (0: one per core)\n"
+             << "  --explore-threads N  expand each product with N >= 1 threads before searching it\n"
+             << "  --translator T       translate formulas with T: elementary (default) or tableau\n"
+             << "  --generalized        check the generalized Buchi automata without degeneralizing\n"
+             << "  --no-reduce          skip the reduction of the automata\n"
+             << "  --parallel-check     search each product for accepting cycles with the explore threads\n"
+             << "  --cross-check        compare every result with the sequential SCC search\n"
+             << "  --por                reduce the products by partial order for formulas without X\n"
+             << "  --bitstate S         search with a bitstate table of S bytes (suffix K, M or G), probabilistic\n"
+             << "  --hashes K           bits per state in the bitstate table (default 3)\n"
+             << "  --write-binary F     convert the TS file to the binary format in F and exit\n"
+             << "  --stats F            write the stage times and sizes of every query to F as JSON lines\n"
+             << "  --counterexample F   write a violating run of every failing formula to F as JSON lines\n"
+             << "  --verbose            print statistics to stderr\n";
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+   int files = 0;
+   for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--threads" && i + 1 < argc) {
+         if (!ParseCount(argv[++i], options.thread_count) || options.thread_count < 0) {
+            PrintUsage(argv[0]);
+            return false;
+         }
+      } else if (arg == "--explore-threads" && i + 1 < argc) {
+         if (!ParseCount(argv[++i], options.explore_threads) || options.explore_threads < 1) {
+            PrintUsage(argv[0]);
+            return false;
+         }
+      } else if (arg == "--translator" && i + 1 < argc) {
+         options.translator = argv[++i];
+         if (options.translator != "elementary" && options.translator != "tableau") {
+            PrintUsage(argv[0]);
+            return false;
+         }
+      } else if (arg == "--generalized") {
+         options.generalized = true;
+      } else if (arg == "--no-reduce") {
+         options.reduce = false;
+      } else if (arg == "--parallel-check") {
+         options.parallel_check = true;
+      } else if (arg == "--cross-check") {
+         options.cross_check = true;
+      } else if (arg == "--por") {
+         options.por = true;
+      } else if (arg == "--bitstate" && i + 1 < argc) {
+         options.bitstate_bytes = ParseSize(argv[++i]);
+         if (options.bitstate_bytes == 0) {
+            PrintUsage(argv[0]);
+            return false;
+         }
+      } else if (arg == "--hashes" && i + 1 < argc) {
+         options.bitstate_hashes = std::atoi(argv[++i]);
+         if (options.bitstate_hashes < 1) {
+            PrintUsage(argv[0]);
+            return false;
+         }
+      } else if (arg == "--write-binary" && i + 1 < argc) {
+         options.binary_path = argv[++i];
+      } else if (arg == "--stats" && i + 1 < argc) {
+         options.stats_path = argv[++i];
+      } else if (arg == "--counterexample" && i + 1 < argc) {
+         options.counterexample_path = argv[++i];
+      } else if (arg == "--verbose") {
+         options.verbose = true;
+      } else if (arg.size() > 1 && arg[0] == '-') {
+         PrintUsage(argv[0]);
+         return false;
+      } else if (files == 0) {
+         options.ts_path = arg;
+         ++files;
+      } else if (files == 1) {
+         options.ltl_path = arg;
+         ++files;
+      } else {
+         PrintUsage(argv[0]);
+         return false;
+      }
+   }
+   return true;
+}
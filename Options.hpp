@@ -0,0 +1,52 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <string>
+#include <cstdint>
+
+// Command line options
+struct Options {
+   std::string ts_path;
+   std::string ltl_path;
+   // if set, write the TS in the binary format to this file and exit
+   std::string binary_path;
+   // if set, write the statistics of every query to this file
+   std::string stats_path;
+   // if set, write a violating run of every formula that fails to this file
+   std::string counterexample_path;
+   // number of worker threads checking formulas, 0 means one per core
+   int thread_count;
+   // threads expanding each product before it is searched, at least 1;
+   // 1 searches the product on the fly
+   int explore_threads;
+   // LTL to automaton translation: "elementary" or "tableau"
+   std::string translator;
+   // check the GNBA directly instead of degeneralizing it to an NBA
+   bool generalized;
+   // shrink the automata before building products
+   bool reduce;
+   // search each product for an accepting cycle with OWCTY on the explore
+   // threads instead of a sequential DFS
+   bool parallel_check;
+   // check every result again with the sequential SCC search and fail when
+   // they differ
+   bool cross_check;
+   // reduce the products by the partial order of the TS actions, for the
+   // formulas without X
+   bool por;
+   // if not 0, search on the fly with a bitstate table of this many bytes
+   // instead of storing the product states
+   uint64_t bitstate_bytes;
+   // bits set per state in the bitstate table
+   int bitstate_hashes;
+   // print statistics to stderr
+   bool verbose;
+   Options() : thread_count(1), explore_threads(1), translator("elementary"), generalized(false), reduce(true),
+               parallel_check(false), cross_check(false), por(false),
+               bitstate_bytes(0), bitstate_hashes(3), verbose(false) {}
+};
+
+// Returns false and prints the usage on a malformed command line
+bool ParseOptions(int argc, char *argv[], Options &options);
+
+#endif
@@ -0,0 +1,217 @@
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "ParallelExplorer.hpp"
+
+ConcurrentStateSet::ConcurrentStateSet(uint64_t capacity) : capacity(1024), count(0) {
+   while (this->capacity < capacity) {
+      this->capacity <<= 1;
+   }
+   slots.reset(new std::atomic<uint64_t>[this->capacity]());
+}
+
+bool ConcurrentStateSet::insert(uint64_t key) {
+   uint64_t mask = capacity - 1;
+   for (uint64_t i = MixKey(key) & mask; ; i = (i + 1) & mask) {
+      uint64_t current = slots[i].load(std::memory_order_acquire);
+      if (current == 0) {
+         if (slots[i].compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+         }
+         // another thread claimed the slot first, current holds its key
+      }
+      if (current == key) {
+         return false;
+      }
+   }
+}
+
+int64_t ConcurrentStateSet::find(uint64_t key) const {
+   uint64_t mask = capacity - 1;
+   for (uint64_t i = MixKey(key) & mask; ; i = (i + 1) & mask) {
+      uint64_t current = slots[i].load(std::memory_order_acquire);
+      if (current == key) return i;
+      if (current == 0) return -1;
+   }
+}
+
+void ConcurrentStateSet::grow() {
+   std::unique_ptr<std::atomic<uint64_t>[]> old = std::move(slots);
+   uint64_t old_capacity = capacity;
+   capacity <<= 1;
+   slots.reset(new std::atomic<uint64_t>[capacity]());
+   count.store(0, std::memory_order_relaxed);
+   for (uint64_t i = 0; i < old_capacity; ++i) {
+      uint64_t key = old[i].load(std::memory_order_relaxed);
+      if (key != 0) insert(key);
+   }
+}
+
+ParallelExplorer::ParallelExplorer(std::shared_ptr<Product> prod, int thread_count)
+   : prod(prod), thread_count(std::max(1, thread_count)), visited(4 * prod->get_state_count()), active(0),
+     idle(0), grow_requested(false), stopped(0), grow_epoch(0), edges(this->thread_count), seconds(0) {}
+
+// Returns false without recording anything if a grow of the visited set
+// interrupted the expansion
+bool ParallelExplorer::expand(uint64_t key, std::vector<uint64_t> &found, std::vector<uint64_t> &out,
+                              std::vector<char> &in_ample) {
+   size_t mark = out.size();
+   out.push_back(key);
+   out.push_back(0);
+   bool aborted = false;
+   int ts_id = ConcurrentStateSet::get_ts_id(key), nba_id = ConcurrentStateSet::get_nba_id(key);
+   prod->for_each_reduced_successor(ts_id, nba_id, in_ample, [&](int i2, int j2) {
+      if (aborted) return;
+      if (grow_requested.load(std::memory_order_relaxed)) {
+         aborted = true;
+         return;
+      }
+      uint64_t to = ConcurrentStateSet::pack(i2, j2);
+      prod->mark_seen(i2);
+      if (visited.insert(to)) {
+         found.push_back(to);
+         if (visited.size() * 2 > visited.get_capacity()) {
+            grow_requested.store(true, std::memory_order_relaxed);
+         }
+      }
+      out.push_back(to);
+   });
+   if (aborted) {
+      out.resize(mark);
+      return false;
+   }
+   out[mark + 1] = out.size() - mark - 2;
+   return true;
+}
+
+// A worker expands the states on its own stack without taking the lock, and
+// only hands half of them to the shared frontier when another worker is idle
+void ParallelExplorer::work(int worker) {
+   const size_t BATCH = 64;
+   std::vector<uint64_t> stack, found;
+   std::vector<char> in_ample;
+   std::unique_lock<std::mutex> guard(lock);
+   while (true) {
+      if (grow_requested.load(std::memory_order_relaxed)) {
+         // the last worker to arrive grows the table while the others wait
+         wake.notify_all();
+         if (++stopped == thread_count) {
+            visited.grow();
+            stopped = 0;
+            ++grow_epoch;
+            grow_requested.store(false, std::memory_order_relaxed);
+            wake.notify_all();
+         } else {
+            int epoch = grow_epoch;
+            wake.wait(guard, [&]() { return grow_epoch != epoch; });
+         }
+         continue;
+      }
+      if (!stack.empty()) {
+         guard.unlock();
+         while (!stack.empty() && !grow_requested.load(std::memory_order_relaxed)) {
+            // an interrupted state stays on the stack and is expanded again
+            if (!expand(stack.back(), found, edges[worker], in_ample)) break;
+            stack.pop_back();
+            stack.insert(stack.end(), found.begin(), found.end());
+            found.clear();
+            if (idle.load(std::memory_order_relaxed) > 0 && stack.size() > 1) break;
+         }
+         stack.insert(stack.end(), found.begin(), found.end());
+         found.clear();
+         guard.lock();
+         if (idle.load(std::memory_order_relaxed) > 0 && stack.size() > 1) {
+            size_t half = stack.size() / 2;
+            frontier.insert(frontier.end(), stack.begin(), stack.begin() + half);
+            stack.erase(stack.begin(), stack.begin() + half);
+            wake.notify_all();
+         }
+         if (stack.empty() && --active == 0 && frontier.empty()) {
+            wake.notify_all();
+         }
+         continue;
+      }
+      if (!frontier.empty()) {
+         size_t take = std::min(BATCH, frontier.size());
+         stack.assign(frontier.end() - take, frontier.end());
+         frontier.resize(frontier.size() - take);
+         ++active;
+         continue;
+      }
+      if (active == 0) {
+         wake.notify_all();
+         return;
+      }
+      idle.fetch_add(1, std::memory_order_relaxed);
+      wake.wait(guard);
+      idle.fetch_sub(1, std::memory_order_relaxed);
+   }
+}
+
+// Renumber the states in key order and store the successors as the CSR of
+// the product. Every state is expanded, so the state table needs no index.
+void ParallelExplorer::build() {
+   std::vector<uint64_t> keys;
+   keys.reserve(visited.size());
+   for (uint64_t i = 0; i < visited.get_capacity(); ++i) {
+      if (visited.get_key(i) != 0) keys.push_back(visited.get_key(i));
+   }
+   std::sort(keys.begin(), keys.end());
+   std::vector<int> slot_id(visited.get_capacity(), -1);
+   for (size_t r = 0; r < keys.size(); ++r) {
+      slot_id[visited.find(keys[r])] = r;
+   }
+   auto id_of = [&](uint64_t key) {
+      return slot_id[visited.find(key)];
+   };
+   int n = keys.size();
+   std::vector<int> initial;
+   for (auto &i : prod->initial) {
+      initial.push_back(id_of(prod->states.get_key(i) + 1));
+   }
+   prod->initial = initial;
+   for (auto &key : keys) {
+      key -= 1;
+   }
+   prod->states.assign(std::move(keys));
+   prod->succ_count.assign(n, 0);
+   prod->succ_offset.assign(n, 0);
+   for (auto &out : edges) {
+      for (size_t k = 0; k < out.size(); k += out[k + 1] + 2) {
+         prod->succ_count[id_of(out[k])] = out[k + 1];
+      }
+   }
+   int total = 0;
+   for (int r = 0; r < n; ++r) {
+      prod->succ_offset[r] = total;
+      total += prod->succ_count[r];
+   }
+   prod->targets.resize(total);
+   for (auto &out : edges) {
+      for (size_t k = 0; k < out.size(); k += out[k + 1] + 2) {
+         int offset = prod->succ_offset[id_of(out[k])];
+         for (uint64_t e = 0; e < out[k + 1]; ++e) {
+            prod->targets[offset + e] = id_of(out[k + 2 + e]);
+         }
+      }
+      std::vector<uint64_t>().swap(out);
+   }
+}
+
+void ParallelExplorer::explore() {
+   auto start = std::chrono::steady_clock::now();
+   for (auto &i : prod->initial) {
+      uint64_t key = prod->states.get_key(i) + 1;
+      if (visited.insert(key)) frontier.push_back(key);
+   }
+   std::vector<std::thread> threads;
+   for (int i = 0; i < thread_count; ++i) {
+      threads.push_back(std::thread(&ParallelExplorer::work, this, i));
+   }
+   for (auto &thread : threads) {
+      thread.join();
+   }
+   build();
+   seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
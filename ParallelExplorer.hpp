@@ -0,0 +1,92 @@
+#ifndef PARALLEL_EXPLORER_HPP
+#define PARALLEL_EXPLORER_HPP
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+#include "Product.hpp"
+
+// Set of product states that many threads insert into at once.
+// A state (s, q) is packed into one 64-bit key, and the keys live in an
+// open-addressing table with linear probing whose slots are claimed by
+// compare-and-swap, so inserts take no lock. Growing the table is not
+// concurrent: every inserting thread has to be stopped first.
+class ConcurrentStateSet {
+ private:
+   std::unique_ptr<std::atomic<uint64_t>[]> slots;
+   uint64_t capacity;
+   std::atomic<uint64_t> count;
+ public:
+   // capacity is rounded up to a power of two
+   ConcurrentStateSet(uint64_t capacity);
+   // The key of StateTable plus 1, as 0 marks an empty slot
+   static uint64_t pack(int ts_id, int nba_id) {
+      return StateTable::pack(ts_id, nba_id) + 1;
+   }
+   static int get_ts_id(uint64_t key) {
+      return (key - 1) >> 32;
+   }
+   static int get_nba_id(uint64_t key) {
+      return (uint32_t) (key - 1);
+   }
+   // Returns true if the key was not in the set yet
+   bool insert(uint64_t key);
+   // The slot of the key, or -1
+   int64_t find(uint64_t key) const;
+   uint64_t get_key(uint64_t slot) const {
+      return slots[slot].load(std::memory_order_relaxed);
+   }
+   uint64_t size() const {
+      return count.load(std::memory_order_relaxed);
+   }
+   uint64_t get_capacity() const {
+      return capacity;
+   }
+   // Double the capacity, must not run concurrently with anything else
+   void grow();
+};
+
+// Expands every reachable state of a product with several threads.
+// The workers take batches of states from a shared frontier and expand them
+// depth first on a private stack, pushing the successors the visited set had
+// not seen yet. A worker gives half of its stack back to the frontier when
+// another worker is idle. When the visited set is half full, the workers stop at a barrier, one of
+// them grows the table and all go on; a worker that is stopped in the middle
+// of a state puts the state back and expands it again later.
+// In the end the states are numbered in key order and the successor lists
+// are written into the product, so any search can then run on it without
+// expanding anything.
+class ParallelExplorer {
+ private:
+   std::shared_ptr<Product> prod;
+   int thread_count;
+   ConcurrentStateSet visited;
+   std::mutex lock;
+   std::condition_variable wake;
+   std::vector<uint64_t> frontier;
+   // workers with a non-empty stack, and workers waiting for work
+   int active;
+   std::atomic<int> idle;
+   std::atomic<bool> grow_requested;
+   // workers waiting at the barrier, and the number of finished barriers
+   int stopped;
+   int grow_epoch;
+   // per worker: the expanded states as key, successor count, successor keys
+   std::vector<std::vector<uint64_t>> edges;
+   double seconds;
+   bool expand(uint64_t key, std::vector<uint64_t> &found, std::vector<uint64_t> &out, std::vector<char> &in_ample);
+   void work(int worker);
+   void build();
+ public:
+   ParallelExplorer(std::shared_ptr<Product> prod, int thread_count);
+   // Must run before any search on the product, since the states get new ids
+   void explore();
+   double get_seconds() const {
+      return seconds;
+   }
+};
+
+#endif
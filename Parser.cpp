@@ -1,4 +1,6 @@
 #include <stack>
+#include <cstdio>
+#include <cstdlib>
 #include <assert.h>
 #include "Utils.hpp"
 #include "Parser.hpp"
@@ -58,61 +60,75 @@ void Parser::init() {
    current = tokenizer();
 }
 
-Token Parser::tokenizer() {
-   static char c;
-   static bool consumed = true;
-   if (!consumed) {
-      consumed = true;
-   } else {
-      if ((c = fin.get()) == EOF) c = 0;
+// Read the next block of the stream
+bool Parser::fill() {
+   if (!fin) return false;
+   offset += end - begin;
+   fin->read(buffer.data(), buffer.size());
+   begin = pos = buffer.data();
+   end = begin + fin->gcount();
+   return pos < end;
+}
+
+// The second character of a two-character operator
+void Parser::expect(char c) {
+   if (peek_char() != c) {
+      failwith("expected '%c' at byte %lld\n", c, get_bytes_read());
+      exit(EXIT_FAILURE);
    }
-   if (!c) return Token(TOKEN_TYPE::NONE);
-   else if (c == '(') return Token(TOKEN_TYPE::LPAREN);
-   else if (c == ')') return Token(TOKEN_TYPE::RPAREN);
-   else if (c == '!') return Token(TOKEN_TYPE::NEG);
-   else if (c == 'X') return Token(TOKEN_TYPE::NEXT);
-   else if (c == 'U') return Token(TOKEN_TYPE::UNTIL);
-   else if (c == 'G') return Token(TOKEN_TYPE::ALWAYS);
-   else if (c == 'F') return Token(TOKEN_TYPE::EVENTUALLY);
-   else if (c == '\\') {
-      fin.get(c);
-      assert(c == '/');
-      return Token(TOKEN_TYPE::DISJ);
-   } else if (c == '/') {
-      fin.get(c);
-      assert(c == '\\');
-      return Token(TOKEN_TYPE::CONJ);
-   } else if (c == '-') {
-      fin.get(c);
-      assert(c == '>');
-      return Token(TOKEN_TYPE::IMPLIES);
-   } else if ('a' <= c && c <= 'z') {
-      std::string var_name;
-      while ('a' <= c && c <= 'z') {
-         var_name.push_back(c); 
-         if ((c = fin.get()) == EOF) break;
-      }
-      consumed = false;
-      return Token(var_name);
-   } else if ('0' <= c && c <= '9') {
-      int number = 0;
-      while ('0' <= c && c <= '9') {
-         number = number * 10 + c - '0';
-         if ((c = fin.get()) == EOF) break;
+   ++pos;
+}
+
+// Blanks and unknown characters are skipped
+Token Parser::tokenizer() {
+   while (true) {
+      char c = peek_char();
+      if (!c) return Token(TOKEN_TYPE::NONE);
+      ++pos;
+      if (c == '(') return Token(TOKEN_TYPE::LPAREN);
+      else if (c == ')') return Token(TOKEN_TYPE::RPAREN);
+      else if (c == '!') return Token(TOKEN_TYPE::NEG);
+      else if (c == 'X') return Token(TOKEN_TYPE::NEXT);
+      else if (c == 'U') return Token(TOKEN_TYPE::UNTIL);
+      else if (c == 'G') return Token(TOKEN_TYPE::ALWAYS);
+      else if (c == 'F') return Token(TOKEN_TYPE::EVENTUALLY);
+      else if (c == '\\') {
+         expect('/');
+         return Token(TOKEN_TYPE::DISJ);
+      } else if (c == '/') {
+         expect('\\');
+         return Token(TOKEN_TYPE::CONJ);
+      } else if (c == '-') {
+         expect('>');
+         return Token(TOKEN_TYPE::IMPLIES);
+      } else if ('a' <= c && c <= 'z') {
+         std::string var_name(1, c);
+         do {
+            const char *start = pos;
+            while (pos < end && 'a' <= *pos && *pos <= 'z') ++pos;
+            var_name.append(start, pos);
+         } while (pos == end && fill());
+         return Token(std::move(var_name));
+      } else if ('0' <= c && c <= '9') {
+         int number = c - '0';
+         // scan the block directly, a number may go on in the next block
+         do {
+            while (pos < end && '0' <= *pos && *pos <= '9') {
+               number = number * 10 + (*pos++ - '0');
+            }
+         } while (pos == end && fill());
+         return Token(number);
+      } else if (c == '\n') {
+         return Token(TOKEN_TYPE::ENDLINE);
       }
-      consumed = false;
-      return Token(number);
-   } else if (c == '\n') {
-      return Token(TOKEN_TYPE::ENDLINE);
    }
-   return tokenizer();
 }
 
 Token Parser::consume() {
 #ifdef DEBUG
    std::cerr << "Consume: " << current << std::endl;   
 #endif
-   Token tmp(current);
+   Token tmp(std::move(current));
    current = tokenizer();
 #ifdef DEBUG
    std::cerr << "Get new token: " << current << std::endl;
@@ -130,27 +146,29 @@ Token Parser::peek() {
 }
 
 ExprPtr Parser::parse() {
+   ExprFactory &factory = GetExprFactory();
    Token token = consume();
    ExprPtr left = nullptr;
    switch (token.type) {
       case TOKEN_TYPE::VAR: {
-         left = std::make_unique<VarExpr>(token.var_name);
+         // an AP the TS does not have gets no id, so no guard constrains it
+         left = factory.make_var(token.var_name, aps ? aps->lookup(token.var_name) : -1);
          break;
       }
       case TOKEN_TYPE::NEG: {
-         left = std::make_unique<UnaryExpr>(ExprType::NEG, parse());
+         left = factory.make_unary(ExprType::NEG, parse());
          break;
       }
       case TOKEN_TYPE::NEXT: {
-         left = std::make_unique<UnaryExpr>(ExprType::NEXT, parse());
+         left = factory.make_unary(ExprType::NEXT, parse());
          break;
       }
       case TOKEN_TYPE::ALWAYS: {
-         left = std::make_unique<UnaryExpr>(ExprType::ALWAYS, parse());
+         left = factory.make_unary(ExprType::ALWAYS, parse());
          break;
       }
       case TOKEN_TYPE::EVENTUALLY: {
-         left = std::make_unique<UnaryExpr>(ExprType::EVENTUALLY, parse());
+         left = factory.make_unary(ExprType::EVENTUALLY, parse());
          break;
       }
       case TOKEN_TYPE::LPAREN: {
@@ -159,7 +177,8 @@ ExprPtr Parser::parse() {
          break;
       }
       default: {
-         failwith("Not a prefix token");
+         failwith("not a prefix token at byte %lld\n", get_bytes_read());
+         exit(EXIT_FAILURE);
       }
    }
    while (true) {
@@ -169,23 +188,24 @@ ExprPtr Parser::parse() {
       ExprPtr right = parse();
       switch (token.type) {
          case TOKEN_TYPE::CONJ: {
-            left = std::make_unique<BinaryExpr>(ExprType::CONJ, left, right);
+            left = factory.make_binary(ExprType::CONJ, left, right);
             break;
          }
          case TOKEN_TYPE::DISJ: {
-            left = std::make_unique<BinaryExpr>(ExprType::DISJ, left, right);
+            left = factory.make_binary(ExprType::DISJ, left, right);
             break;
          }
          case TOKEN_TYPE::IMPLIES: {
-            left = std::make_unique<BinaryExpr>(ExprType::IMPL, left, right);
+            left = factory.make_binary(ExprType::IMPL, left, right);
             break;
          }
          case TOKEN_TYPE::UNTIL: {
-            left = std::make_unique<BinaryExpr>(ExprType::UNTIL, left, right);
+            left = factory.make_binary(ExprType::UNTIL, left, right);
             break;
          }
          default: {
-            failwith("Not an infix token");
+            failwith("not an infix token at byte %lld\n", get_bytes_read());
+            exit(EXIT_FAILURE);
          }
       }
    }
@@ -1,6 +1,7 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include "Expr.hpp"
@@ -22,15 +23,7 @@ class Token {
    Token() : type(TOKEN_TYPE::NONE), number(0), var_name("") {}
    Token(TOKEN_TYPE type) : type(type), number(0), var_name("") {}
    Token(int number) : type(TOKEN_TYPE::NUMBER), number(number) {}
-   Token(std::string var_name) : type(TOKEN_TYPE::VAR), var_name(var_name) {}
-   Token(const Token &obj)
-      : type(obj.type), number(obj.number), var_name(obj.var_name) {}
-   Token& operator = (const Token &obj) {
-      type = obj.type;
-      var_name = obj.var_name;
-      number = obj.number;
-      return *this;
-   }
+   Token(std::string var_name) : type(TOKEN_TYPE::VAR), number(0), var_name(std::move(var_name)) {}
    bool is_infix_token() {
       return type == TOKEN_TYPE::CONJ || type == TOKEN_TYPE::DISJ || 
              type == TOKEN_TYPE::IMPLIES || type == TOKEN_TYPE::UNTIL;
@@ -38,18 +31,52 @@ class Token {
    friend std::ostream &operator<<(std::ostream &os, const Token &token);
 };
 
+// Tokenizer and formula parser.
+// The input is either a stream, read in blocks of BUFFER_SIZE bytes, or a
+// string parsed in place, so characters are taken from memory without a
+// stream call each. All state is in the object, so several parsers can run
+// at once on different threads.
 class Parser {
  private:
-   std::istream &fin;
+   static const size_t BUFFER_SIZE = 1 << 16;
+   // nullptr when parsing a string
+   std::istream *fin;
+   std::vector<char> buffer;
+   // the unread part of the input in memory, and where it started
+   const char *begin;
+   const char *pos;
+   const char *end;
+   // bytes of the blocks before the current one
+   long long offset;
+   APTablePtr aps;
    Token current;
+   bool fill();
+   // The next character without taking it, 0 at the end of the input
+   char peek_char() {
+      if (pos == end && !fill()) return 0;
+      return *pos;
+   }
+   void expect(char c);
    Token tokenizer();
  public:
    void init();
-   Parser(std::istream &fin) : fin(fin) { init(); }
+   Parser(std::istream &fin, APTablePtr aps = nullptr)
+      : fin(&fin), buffer(BUFFER_SIZE), begin(nullptr), pos(nullptr), end(nullptr), offset(0), aps(aps) {
+      init();
+   }
+   // text has to outlive the parser
+   Parser(const std::string &text, APTablePtr aps = nullptr)
+      : fin(nullptr), begin(text.data()), pos(text.data()), end(text.data() + text.size()), offset(0), aps(aps) {
+      init();
+   }
    Token consume();
    void consume_until_endline();
    Token peek();
    ExprPtr parse();
+   // bytes taken from the input so far
+   long long get_bytes_read() const {
+      return offset + (pos - begin);
+   }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <unordered_map>
+#include "PartialOrder.hpp"
+
+// The relations are computed from every state and edge of the TS once, so
+// they hold wherever the product goes
+PartialOrder::PartialOrder(const TS &ts) : graph(ts.get_graph()), actions(ts.get_actions()), action_count(0) {
+   int node_count = graph->get_node_count();
+   const int *offsets = graph->get_offsets();
+   const int *action_offsets = actions->get_offsets();
+   std::unordered_map<int, int> dense;
+   for (int i = 0; i < actions->get_edge_count(); ++i) {
+      auto it = dense.insert(std::make_pair(actions->get_targets()[i], (int) dense.size())).first;
+      edge_actions.push_back(it->second);
+   }
+   action_count = dense.size();
+   enabled_offsets.push_back(0);
+   for (int s = 0; s < node_count; ++s) {
+      // the action rows of the edges of s are contiguous
+      int begin = enabled.size();
+      enabled.insert(enabled.end(), edge_actions.begin() + action_offsets[offsets[s]],
+                     edge_actions.begin() + action_offsets[offsets[s + 1]]);
+      std::sort(enabled.begin() + begin, enabled.end());
+      enabled.erase(std::unique(enabled.begin() + begin, enabled.end()), enabled.end());
+      enabled_offsets.push_back(enabled.size());
+   }
+   if (action_count == 0 || action_count > MAX_ACTIONS) return;
+   dependent.assign(action_count, Bitset(action_count));
+   enablers.assign(action_count, Bitset(action_count));
+   changes.assign(action_count, 0);
+   for (int s = 0; s < node_count; ++s) {
+      for (int e = offsets[s]; e < offsets[s + 1]; ++e) {
+         int t = graph->get_targets()[e];
+         APMask changed = ts.get_label(s) ^ ts.get_label(t);
+         for (int k = action_offsets[e]; k < action_offsets[e + 1]; ++k) {
+            int c = edge_actions[k];
+            changes[c] |= changed;
+            for (int i = enabled_offsets[t]; i < enabled_offsets[t + 1]; ++i) {
+               if (!is_enabled(s, enabled[i])) enablers[enabled[i]].set(c);
+            }
+         }
+      }
+      for (int i = enabled_offsets[s]; i < enabled_offsets[s + 1]; ++i) {
+         for (int j = i + 1; j < enabled_offsets[s + 1]; ++j) {
+            int a = enabled[i], b = enabled[j];
+            if (dependent[a].test(b) || commute(s, a, b)) continue;
+            dependent[a].set(b);
+            dependent[b].set(a);
+         }
+      }
+   }
+}
+
+bool PartialOrder::is_enabled(int ts_id, int action) const {
+   return std::binary_search(enabled.begin() + enabled_offsets[ts_id], enabled.begin() + enabled_offsets[ts_id + 1],
+                             action);
+}
+
+void PartialOrder::post(int ts_id, int action, std::vector<int> &out) const {
+   const int *offsets = graph->get_offsets();
+   const int *action_offsets = actions->get_offsets();
+   for (int e = offsets[ts_id]; e < offsets[ts_id + 1]; ++e) {
+      for (int k = action_offsets[e]; k < action_offsets[e + 1]; ++k) {
+         if (edge_actions[k] == action) out.push_back(graph->get_targets()[e]);
+      }
+   }
+}
+
+// Both a and b are enabled in ts_id. They commute there if each stays
+// enabled after the other and the states after a then b are the states
+// after b then a.
+bool PartialOrder::commute(int ts_id, int a, int b) const {
+   std::vector<int> after_a, after_b, ab, ba;
+   post(ts_id, a, after_a);
+   post(ts_id, b, after_b);
+   for (auto &t : after_a) {
+      if (!is_enabled(t, b)) return false;
+      post(t, b, ab);
+   }
+   for (auto &t : after_b) {
+      if (!is_enabled(t, a)) return false;
+      post(t, a, ba);
+   }
+   std::sort(ab.begin(), ab.end());
+   ab.erase(std::unique(ab.begin(), ab.end()), ab.end());
+   std::sort(ba.begin(), ba.end());
+   ba.erase(std::unique(ba.begin(), ba.end()), ba.end());
+   return ab == ba;
+}
+
+int PartialOrder::get_independent_pairs() const {
+   int pairs = 0;
+   for (auto &row : dependent) {
+      pairs += action_count - row.count();
+   }
+   // every action is independent of itself here
+   return (pairs - (int) dependent.size()) / 2;
+}
+
+// Every enabled action that is invisible seeds a stubborn set, and the
+// closure stops as soon as it is not smaller than the best set so far
+bool PartialOrder::get_ample(int ts_id, APMask visible, std::vector<char> &in_ample) const {
+   int enabled_count = enabled_offsets[ts_id + 1] - enabled_offsets[ts_id];
+   if (!is_usable() || enabled_count < 2) return false;
+   Bitset best;
+   int best_count = enabled_count;
+   std::vector<int> stack;
+   for (int i = enabled_offsets[ts_id]; i < enabled_offsets[ts_id + 1] && best_count > 1; ++i) {
+      int seed = enabled[i];
+      if (changes[seed] & visible) continue;
+      Bitset set(action_count);
+      set.set(seed);
+      stack.assign(1, seed);
+      int count = 0;
+      bool small = true;
+      while (!stack.empty() && small) {
+         int a = stack.back();
+         stack.pop_back();
+         const Bitset *next = &enablers[a];
+         if (is_enabled(ts_id, a)) {
+            small = !(changes[a] & visible) && ++count < best_count;
+            next = &dependent[a];
+         }
+         next->for_each([&](int b) {
+            if (set.test(b)) return;
+            set.set(b);
+            stack.push_back(b);
+         });
+      }
+      if (!small) continue;
+      best = set;
+      best_count = count;
+   }
+   if (best_count == enabled_count) return false;
+   const int *offsets = graph->get_offsets();
+   const int *action_offsets = actions->get_offsets();
+   in_ample.assign(offsets[ts_id + 1] - offsets[ts_id], 0);
+   for (int e = offsets[ts_id]; e < offsets[ts_id + 1]; ++e) {
+      for (int k = action_offsets[e]; k < action_offsets[e + 1]; ++k) {
+         if (best.test(edge_actions[k])) in_ample[e - offsets[ts_id]] = 1;
+      }
+   }
+   return true;
+}
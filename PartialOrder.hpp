@@ -0,0 +1,59 @@
+#ifndef PARTIAL_ORDER_HPP
+#define PARTIAL_ORDER_HPP
+
+#include <vector>
+#include <memory>
+#include "TS.hpp"
+#include "Bitset.hpp"
+
+// Ample sets for partial-order reduction, derived from the action numbers of
+// the transitions of an explicit TS.
+// Two actions are independent if in every state where both are enabled
+// neither disables the other and taking them in either order leads to the
+// same states. An action is visible for a set of APs if one of its edges
+// changes one of them.
+// The ample set of a state is the enabled part of a stubborn set: the set
+// holds every action that depends on one of its enabled actions and every
+// action that can enable one of its disabled actions, so no run can take an
+// action that interferes with it before taking one of its actions. It is
+// only used when it is smaller than the enabled actions and all of its
+// actions are invisible. The product adds the cycle proviso, so the
+// reduction preserves the formulas without X.
+class PartialOrder {
+ private:
+   GraphPtr graph;
+   GraphPtr actions;
+   // dense id of every entry of the action graph
+   std::vector<int> edge_actions;
+   // the dense ids of the enabled actions of every state, sorted
+   std::vector<int> enabled_offsets;
+   std::vector<int> enabled;
+   int action_count;
+   // dependent[a]: the actions that do not commute with a
+   std::vector<Bitset> dependent;
+   // enablers[a]: the actions with an edge into a state where a gets enabled
+   std::vector<Bitset> enablers;
+   // changes[a]: the APs an edge of a changes
+   std::vector<APMask> changes;
+   bool is_enabled(int ts_id, int action) const;
+   // The targets of the edges of ts_id with the given action
+   void post(int ts_id, int action, std::vector<int> &out) const;
+   bool commute(int ts_id, int a, int b) const;
+ public:
+   // Too many actions make the relations too large, the reduction is then off
+   static const int MAX_ACTIONS = 4096;
+   PartialOrder(const TS &ts);
+   int get_action_count() const {
+      return action_count;
+   }
+   bool is_usable() const {
+      return !dependent.empty();
+   }
+   int get_independent_pairs() const;
+   // Set in_ample[k] iff the k-th successor of ts_id is reached by an action
+   // of the smallest ample set that is invisible for the given APs. Returns
+   // false if there is no ample set smaller than the enabled actions.
+   bool get_ample(int ts_id, APMask visible, std::vector<char> &in_ample) const;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include <assert.h>
+#include <chrono>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include "Tableau.hpp"
+#include "Reduction.hpp"
+#include "NestedDFS.hpp"
+#include "SCCProcessor.hpp"
+#include "OWCTYProcessor.hpp"
+#include "ParallelExplorer.hpp"
+#include "BitstateSearch.hpp"
+#include "Pipeline.hpp"
+
+int read_number(Parser &parser) {
+   Token token = parser.consume();
+   assert(token.type == TOKEN_TYPE::NUMBER);
+   return token.number;
+}
+
+// Replace the product states of a lasso by their TS states
+void ProjectLasso(std::shared_ptr<Product> prod, Lasso &lasso) {
+   for (auto &id : lasso.prefix) {
+      id = prod->get_ts_state(id);
+   }
+   for (auto &id : lasso.cycle) {
+      id = prod->get_ts_state(id);
+   }
+}
+
+int CheckLTLByNestedDFS(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba) {
+   return CheckLTLByNestedDFS(ts, nba, ts->get_initial());
+}
+
+// check the formula from the given TS states instead of the initial states
+int CheckLTLByNestedDFS(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba, const std::vector<int> &initial,
+                        Lasso *lasso) {
+   std::shared_ptr<Product> prod = std::make_shared<Product>(ts, nba, initial);
+   std::shared_ptr<NestedDFSProcessor> proc = std::make_shared<NestedDFSProcessor>(prod);
+   bool violated = proc->find_accepting_cycle(lasso);
+   if (violated && lasso) ProjectLasso(prod, *lasso);
+   return violated ? 0 : 1;
+}
+
+// The states of an on-the-fly product are the states the search reached
+// before its verdict
+void AddProductStats(Stats *stats, std::shared_ptr<Product> prod) {
+   if (!stats) return;
+   stats->add("product_states", prod->get_state_count());
+   stats->add("product_edges", prod->get_edge_count());
+   stats->add("product_bytes", prod->get_memory());
+   stats->add("peak_rss_kb", PeakRSSKilobytes());
+}
+
+// The bitstate search generates the product itself and needs a plain NBA
+static bool UseBitstate(std::shared_ptr<NBA_base> nba, const Options &options) {
+   return options.bitstate_bytes > 0 && std::dynamic_pointer_cast<NBA>(nba);
+}
+
+// Build the product of the TS from the given states. With several explore
+// threads, or for OWCTY, it is expanded completely in parallel before it is
+// searched, otherwise the search expands it on the fly. With --por it is
+// reduced by the partial order of the TS if the formula has no X.
+std::shared_ptr<Product> MakeProduct(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba,
+                                     const std::vector<int> &initial, const Options &options, Stats *stats) {
+   std::shared_ptr<const PartialOrder> partial_order = nba->is_next_free() ? ts->get_partial_order() : nullptr;
+   if (stats && ts->get_partial_order()) stats->add_bool("por", partial_order != nullptr);
+   std::shared_ptr<Product> prod = std::make_shared<Product>(ts, nba, initial, partial_order);
+   if ((options.explore_threads > 1 || options.parallel_check) && !UseBitstate(nba, options)) {
+      ParallelExplorer explorer(prod, options.explore_threads);
+      explorer.explore();
+      if (stats) stats->add("explore_ms", explorer.get_seconds() * 1000);
+      if (options.verbose) {
+         std::ostringstream line;
+         line << "product: " << prod->get_state_count() << " states " << prod->get_edge_count() << " edges, "
+              << explorer.get_seconds() * 1000 << " ms, "
+              << (long long) (prod->get_state_count() / std::max(explorer.get_seconds(), 1e-9)) << " states/s\n";
+         std::cerr << line.str();
+      }
+   }
+   return prod;
+}
+
+// check the formula from each of the given TS states with one exploration of
+// the product: the i-th result is 1 iff no violating run starts in states[i]
+std::vector<int> CheckLTLFromStates(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba,
+                                    const std::vector<int> &states, const Options &options, Stats *stats) {
+   std::shared_ptr<Product> prod = MakeProduct(ts, nba, states, options, stats);
+   StageTimer timer(stats);
+   std::shared_ptr<SCCProcessor> scc = std::make_shared<SCCProcessor>(prod);
+   std::vector<bool> violating = scc->find_violating_states();
+   timer.stage("search");
+   AddProductStats(stats, prod);
+   std::vector<bool> ts_violating(ts->get_node_count(), false);
+   for (auto &id : prod->get_initial()) {
+      if (violating[id]) ts_violating[prod->get_ts_state(id)] = true;
+   }
+   std::vector<int> result;
+   for (auto &state : states) {
+      bool valid = state >= 0 && state < (int) ts_violating.size();
+      result.push_back(valid && ts_violating[state] ? 0 : 1);
+   }
+   return result;
+}
+
+// check if the TS satisfies the LTL formula. Works on an NBA or a GNBA.
+int CheckLTLByScc(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba) {
+   return CheckLTLByScc(ts, nba, ts->get_initial());
+}
+
+int CheckLTLByScc(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba, const std::vector<int> &initial,
+                  Lasso *lasso) {
+   std::shared_ptr<Product> prod = std::make_shared<Product>(ts, nba, initial);
+   std::shared_ptr<SCCProcessor> scc = std::make_shared<SCCProcessor>(prod);
+   bool violated = scc->find_accepting_scc(lasso);
+   if (violated && lasso) ProjectLasso(prod, *lasso);
+   return violated ? 0 : 1;
+}
+
+// Run the bitstate search on a product with only its initial states
+static int CheckLTLByBitstate(std::shared_ptr<Product> prod, const Options &options, Stats *stats, Lasso *lasso) {
+   StageTimer timer(stats);
+   BitstateSearch search(prod, options.bitstate_bytes, options.bitstate_hashes);
+   bool violated = search.find_accepting_cycle(lasso);
+   timer.stage("search");
+   const BitstateSet &visited = search.get_visited();
+   if (stats) {
+      stats->add("bitstate_states", search.get_state_count());
+      stats->add("bitstate_fill_percent", visited.get_fill() * 100);
+      stats->add("bitstate_coverage_percent", visited.get_coverage() * 100);
+      stats->add("peak_rss_kb", PeakRSSKilobytes());
+   }
+   if (options.verbose) {
+      std::ostringstream line;
+      line << "bitstate: " << search.get_state_count() << " states, " << visited.get_fill() * 100 << "% of "
+           << visited.get_bit_count() << " bits set, coverage " << visited.get_coverage() * 100 << "%\n";
+      std::cerr << line.str();
+   }
+   return violated ? 0 : 1;
+}
+
+// Nested DFS needs a plain NBA, a GNBA is checked by its SCCs. OWCTY works
+// on both but needs the whole product. The bitstate search replaces them all
+// for a plain NBA.
+int CheckLTL(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> automaton, const std::vector<int> &initial,
+             const Options &options, Stats *stats, Lasso *lasso) {
+   std::shared_ptr<Product> prod = MakeProduct(ts, automaton, initial, options, stats);
+   if (UseBitstate(automaton, options)) return CheckLTLByBitstate(prod, options, stats, lasso);
+   StageTimer timer(stats);
+   bool violated;
+   if (options.parallel_check) {
+      violated = OWCTYProcessor(prod, options.explore_threads).find_accepting_scc();
+      lasso = nullptr;
+   } else if (std::dynamic_pointer_cast<NBA>(automaton)) {
+      violated = std::make_shared<NestedDFSProcessor>(prod)->find_accepting_cycle(lasso);
+   } else {
+      violated = std::make_shared<SCCProcessor>(prod)->find_accepting_scc(lasso);
+   }
+   timer.stage("search");
+   AddProductStats(stats, prod);
+   if (violated && lasso) ProjectLasso(prod, *lasso);
+   return violated ? 0 : 1;
+}
+
+// read TS from a parser on the TS file
+std::shared_ptr<TS> InputTS(Parser &parser) {
+   std::shared_ptr<TS> ts = std::make_shared<TS>();
+   int n, m;
+   Token token;
+   n = read_number(parser);
+   m = read_number(parser);
+   parser.consume_until_endline();
+   std::set<int> initials;
+   while (1) {
+      token = parser.consume();
+      if (token.type == TOKEN_TYPE::ENDLINE || token.type == TOKEN_TYPE::NONE) break;
+      assert(token.type == TOKEN_TYPE::NUMBER);
+      initials.insert(token.number);
+   }
+   parser.consume_until_endline();
+   std::vector<int> aps;
+   APMask ts_ap = 0;
+   while (1) {
+      token = parser.consume();
+      if (token.type == TOKEN_TYPE::ENDLINE || token.type == TOKEN_TYPE::NONE) break;
+      assert(token.type == TOKEN_TYPE::VAR);
+      aps.push_back(ts->get_ap_table()->intern(token.var_name));
+      ts_ap |= APBit(aps.back());
+   }
+   ts->set_ap(ts_ap);
+   GraphBuilder transition(n);
+   for (int i = 0; i < m; ++i) {
+      int from, action, to;
+      from = read_number(parser);
+      action = read_number(parser);
+      to = read_number(parser);
+      parser.consume_until_endline();
+      transition.add_edge(from, to, action);
+   }
+   std::vector<APMask> labels(n, 0);
+   for (int i = 0; i < n; ++i) {
+      while (1) {
+         token = parser.consume();
+         if (token.type == TOKEN_TYPE::ENDLINE || token.type == TOKEN_TYPE::NONE) break;
+         assert(token.type == TOKEN_TYPE::NUMBER);
+         if (token.number > -1) labels[i] |= APBit(aps[token.number]);
+      }
+   }
+   ts->set_labels(std::move(labels));
+   std::vector<int> initial;
+   for (auto &i : initials) {
+      if (i >= 0 && i < n) initial.push_back(i);
+   }
+   ts->set_initial(initial);
+   GraphPtr actions;
+   ts->set_graph(transition.build(actions));
+   ts->set_actions(actions);
+   return ts;
+}
+
+// transform the negation of a formula to NBA. With options.generalized the
+// GNBA is returned instead, unless it has too many acceptance sets for the
+// product's masks.
+std::shared_ptr<NBA_base> TransExpr(ExprPtr expr, const Options &options, Stats *stats) {
+   auto start = std::chrono::steady_clock::now();
+   StageTimer timer(stats);
+   std::shared_ptr<GNBA> gnba;
+   if (options.translator == "tableau") {
+      gnba = LTL_to_GNBA_Tableau(expr);
+   } else {
+      std::shared_ptr<Closure> closure = std::make_shared<Closure>(expr);
+      timer.stage("closure");
+      if (stats) stats->add("closure_size", closure->size());
+      std::shared_ptr<ElementarySet> elementaries = std::make_shared<ElementarySet>(closure);
+      timer.stage("elementary");
+      if (stats) stats->add("elementary_sets", elementaries->get_elementaries().size());
+      gnba = LTL_to_GNBA(elementaries);
+   }
+   timer.stage("gnba");
+   if (stats) {
+      stats->add("gnba_states", gnba->get_node_count());
+      stats->add("gnba_edges", gnba->get_edge_count());
+      stats->add("gnba_sets", gnba->get_accepting_set_count());
+   }
+   std::shared_ptr<NBA_base> nba = gnba, reduced;
+   if (options.generalized && gnba->get_accepting_set_count() <= MAX_ACCEPTING_SETS) {
+      reduced = options.reduce ? ReduceGNBA(gnba) : gnba;
+   } else {
+      std::shared_ptr<NBA> degeneralized = GNBA_to_NBA(gnba);
+      timer.stage("nba");
+      if (stats) {
+         stats->add("nba_states", degeneralized->get_node_count());
+         stats->add("nba_edges", degeneralized->get_edge_count());
+      }
+      nba = degeneralized;
+      reduced = options.reduce ? ReduceNBA(degeneralized) : degeneralized;
+   }
+   if (options.reduce) {
+      timer.stage("reduce");
+      if (stats) {
+         stats->add("reduced_states", reduced->get_node_count());
+         stats->add("reduced_edges", reduced->get_edge_count());
+      }
+   }
+   if (options.verbose) {
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      std::ostringstream line;
+      line << options.translator << " " << *expr << ": GNBA " << gnba->get_node_count() << " states "
+           << gnba->get_edge_count() << " edges";
+      if (nba != gnba) {
+         line << ", NBA " << nba->get_node_count() << " states " << nba->get_edge_count() << " edges";
+      }
+      if (options.reduce) {
+         line << ", reduced " << reduced->get_node_count() << " states " << reduced->get_edge_count() << " edges";
+      }
+      line << ", " << ms << " ms\n";
+      std::cerr << line.str();
+   }
+   reduced->set_next_free(!ExprHasNext(expr));
+   return reduced;
+}
+
@@ -0,0 +1,51 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <vector>
+#include <memory>
+#include "TS.hpp"
+#include "NBA.hpp"
+#include "Expr.hpp"
+#include "Parser.hpp"
+#include "Product.hpp"
+#include "Options.hpp"
+#include "Stats.hpp"
+
+// The stages of a check, shared by the command line tool and the benchmarks:
+// reading a TS, translating a formula and searching the product.
+
+int read_number(Parser &parser);
+
+// read TS from a parser on the TS file
+std::shared_ptr<TS> InputTS(Parser &parser);
+
+// The stages below record their times and sizes into stats if it is not null
+
+// transform the negation of a formula to an NBA or, with options.generalized,
+// a GNBA
+std::shared_ptr<NBA_base> TransExpr(ExprPtr expr, const Options &options, Stats *stats = nullptr);
+
+// Build the product of the TS from the given states, expanded completely
+// first if the options ask for it
+std::shared_ptr<Product> MakeProduct(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba,
+                                     const std::vector<int> &initial, const Options &options,
+                                     Stats *stats = nullptr);
+
+// The checks return 1 if the TS satisfies the formula and 0 otherwise. When
+// it does not and lasso is not null, lasso receives a violating run as TS
+// states, taken from the search that found it. The parallel check of
+// options.parallel_check gives no lasso. With options.bitstate_bytes, a
+// result of 1 is only probable, see BitstateSearch.
+int CheckLTLByNestedDFS(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba);
+int CheckLTLByNestedDFS(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba, const std::vector<int> &initial,
+                        Lasso *lasso = nullptr);
+int CheckLTLByScc(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba);
+int CheckLTLByScc(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba, const std::vector<int> &initial,
+                  Lasso *lasso = nullptr);
+int CheckLTL(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> automaton, const std::vector<int> &initial,
+             const Options &options, Stats *stats = nullptr, Lasso *lasso = nullptr);
+std::vector<int> CheckLTLFromStates(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba,
+                                    const std::vector<int> &states, const Options &options,
+                                    Stats *stats = nullptr);
+
+#endif
@@ -1,65 +1,86 @@
+#include <map>
 #include "Product.hpp"
 
-std::set<std::string> APIntersection(const std::set<std::string> &ap1, const std::set<std::string> &ap2) {
-   std::set<std::string> ap;
-   for (const std::string &a : ap1) {
-      if (ap2.find(a) != ap2.end()) {
-         ap.insert(a);
+// The initial states are (s0, q) with s0 initial in the TS and q the target
+// of a transition of an initial NBA state whose guard matches L(s0)
+Product::Product(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba, const std::vector<int> &ts_initial,
+                 std::shared_ptr<const PartialOrder> partial_order) : ts(ts), nba(nba), partial_order(partial_order) {
+   if (partial_order) ts_status.reset(new std::atomic<char>[ts->get_node_count()]());
+   aps = ts->get_ap() & nba->get_ap();
+   full_acceptance = nba->get_full_acceptance();
+   for (int j = 0; j < nba->get_node_count(); ++j) {
+      acceptance.push_back(nba->get_acceptance(j));
+      std::map<Guard, std::vector<int>> groups;
+      for (auto &e : nba->get_node(j)->get_transition()) {
+         groups[e.second].push_back(e.first);
       }
-   }
-   return ap;
-}
-
-bool APEqual(const std::set<std::string> &ap1, const std::set<std::string> &ap2, const std::set<std::string> &scope) {
-   for (auto &a : scope) {
-      if (ap1.find(a) != ap1.end() && ap2.find(a) == ap2.end()) {
-         return false;
-      }
-      if (ap1.find(a) == ap1.end() && ap2.find(a) != ap2.end()) {
-         return false;
+      nba_edges.push_back(std::vector<EdgeGroup>());
+      for (auto &group : groups) {
+         nba_edges.back().push_back(EdgeGroup{group.first, group.second});
       }
    }
-   return true;
-}
-
-// Product of a TS and an NBA
-std::shared_ptr<TS> ProductTSWithNBA(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba) {
-   std::set<std::string> aps = APIntersection(ts->get_ap(), nba->get_ap());
-   std::shared_ptr<TS> prod = std::make_shared<TS>();
-   prod->set_ap(std::set<std::string>{"accepting"});
-   std::vector<std::vector<TSNodePtr>> nodes(ts->get_node_count());
-   int id = 0;
-   for (int i = 0; i < ts->get_node_count(); ++i) {
-      for (int j = 0; j < nba->get_node_count(); ++j) {
-         int is_initial = 0;
-         for (int k = 0; k < nba->get_node_count(); ++k) {
-            if (nba->get_node(k)->get_is_initial() && 
-                nba->get_node(k)->get_transition().find(j) != nba->get_node(k)->get_transition().end() &&
-                APEqual(nba->get_node(k)->get_ap(), ts->get_node(i)->get_ap(), aps)) {
-               is_initial = 1;
-            }
-         }
-         TSNodePtr node = std::make_shared<TSNode>(id++, 
-                      is_initial && ts->get_node(i)->get_is_initial(), 
-                      nba->get_node(j)->get_is_accepting() ? std::set<std::string>{"accepting"} : std::set<std::string>{});
-         nodes[i].push_back(node);
-         prod->add_node(node);
-      }
-   }
-   for (int i1 = 0; i1 < ts->get_node_count(); ++i1) {
-      for (int j1 = 0; j1 < nba->get_node_count(); ++j1) {
-         for (int i2 = 0; i2 < ts->get_node_count(); ++i2) {
-            for (int j2 = 0; j2 < nba->get_node_count(); ++j2) {
-               TSNodePtr node1 = nodes[i1][j1];
-               TSNodePtr node2 = nodes[i2][j2];
-               if (APEqual(nba->get_node(j1)->get_ap(), ts->get_node(i2)->get_ap(), aps) &&
-                   ts->get_node(i1)->get_transition().find(i2) != ts->get_node(i1)->get_transition().end() &&
-                   nba->get_node(j1)->get_transition().find(j2) != nba->get_node(j1)->get_transition().end()) {
-                  prod->add_transition(node1->get_id(), node2->get_id());
+   for (auto &i : ts_initial) {
+      // like the initial states of a TS file, ids outside the TS are ignored
+      if (i < 0 || i >= ts->get_node_count()) continue;
+      for (auto &k : nba->get_initial()) {
+         for (auto &group : nba_edges[k]) {
+            if (!group.guard.holds(ts->get_label(i), aps)) continue;
+            for (auto &j : group.targets) {
+               // only initial states exist yet, so a state is new iff its id is
+               // the next position in initial
+               int id = get_or_add_state(i, j);
+               if (id == (int) initial.size()) {
+                  initial.push_back(id);
                }
             }
          }
       }
    }
-   return prod;
-}
\ No newline at end of file
+}
+
+int Product::get_or_add_state(int ts_id, int nba_id) {
+   int count = states.size();
+   // mark_seen must come first, and marking a seen state again changes nothing
+   mark_seen(ts_id);
+   int id = states.find_or_add(StateTable::pack(ts_id, nba_id));
+   if (id == count) {
+      succ_offset.push_back(-1);
+      succ_count.push_back(0);
+   }
+   return id;
+}
+
+// (s, q) -> (s', q') iff s -> s' in the TS and q -> q' in the NBA with a
+// guard matching L(s')
+void Product::expand(int id) {
+   int offset = targets.size();
+   for_each_reduced_successor(get_ts_state(id), get_nba_state(id), in_ample, [&](int i2, int j2) {
+      int to = get_or_add_state(i2, j2);
+      targets.push_back(to);
+   });
+   succ_offset[id] = offset;
+   succ_count[id] = targets.size() - offset;
+}
+
+// The first expansion of a product state with ts_id decides for all of them:
+// the ample set is kept iff none of its successors was seen yet. A reduced
+// state is then decided before its ample successors, so every cycle of the
+// reduced TS has a fully expanded state, in whatever order and on however
+// many threads the states are expanded.
+bool Product::use_ample(int ts_id, std::vector<char> &in_ample) const {
+   char status = ts_status[ts_id].load();
+   if (status == FULL || !partial_order->get_ample(ts_id, aps, in_ample)) return false;
+   if (status == REDUCED) return true;
+   char decision = REDUCED;
+   EdgeRange succ = ts->get_successors(ts_id);
+   for (int k = 0; k < succ.size(); ++k) {
+      if (in_ample[k] && ts_status[succ[k]].load() != UNSEEN) decision = FULL;
+   }
+   // another thread may have decided in the meantime
+   if (!ts_status[ts_id].compare_exchange_strong(status, decision)) decision = status;
+   return decision == REDUCED;
+}
+
+uint64_t Product::get_memory() const {
+   return states.get_memory() + (succ_offset.capacity() + succ_count.capacity() + targets.capacity()) * sizeof(int);
+}
@@ -1,10 +1,146 @@
 #ifndef PRODUCT_HPP
 #define PRODUCT_HPP
 
-#include <stack>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include "TS.hpp"
 #include "NBA.hpp"
+#include "StateTable.hpp"
+#include "PartialOrder.hpp"
 
-std::shared_ptr<TS> ProductTSWithNBA(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba);
+// A run of the product ending in a cycle: the states of prefix, then the
+// states of cycle repeated forever
+struct Lasso {
+   std::vector<int> prefix;
+   std::vector<int> cycle;
+};
 
-#endif 
\ No newline at end of file
+// Product of a TS and an NBA, explored on the fly.
+// A product state is a pair (TS node, NBA node), packed into a 64-bit key of
+// the state table. States get their ids in the order they are reached, and
+// the successors of a state are only generated when a search asks for them,
+// so unreachable pairs are never allocated.
+// The automaton is an NBA or, to skip the degeneralization, a GNBA: every
+// product state carries the acceptance sets of its automaton state.
+// The transitions of every automaton state are grouped by guard, so a guard
+// is evaluated once per TS edge however many targets it leads to.
+// Expanding a state appends its successors to one contiguous target array,
+// which makes the explored part of the product an append-only CSR graph.
+// With a partial order, the product is built on a reduced TS: a TS state
+// either keeps only the edges of its ample set or all of its edges, the same
+// for every automaton state it is paired with.
+class Product {
+   friend class ParallelExplorer;
+   friend class BitstateSearch;
+ private:
+   struct EdgeGroup {
+      Guard guard;
+      std::vector<int> targets;
+   };
+   std::shared_ptr<TS> ts;
+   std::shared_ptr<NBA_base> nba;
+   APMask aps;
+   // acceptance sets of every automaton state, and the mask of all sets
+   std::vector<AcceptMask> acceptance;
+   AcceptMask full_acceptance;
+   std::vector<std::vector<EdgeGroup>> nba_edges;
+   StateTable states;
+   std::vector<int> initial;
+   std::vector<int> succ_offset;
+   std::vector<int> succ_count;
+   std::vector<int> targets;
+   std::shared_ptr<const PartialOrder> partial_order;
+   // With a partial order, the status of every TS state: UNSEEN until a
+   // product state with it is added, REDUCED or FULL from the first expansion
+   // of such a state on. The threads of a ParallelExplorer share it.
+   enum TSStatus : char { UNSEEN, SEEN, REDUCED, FULL };
+   std::unique_ptr<std::atomic<char>[]> ts_status;
+   std::vector<char> in_ample;
+   int get_or_add_state(int ts_id, int nba_id);
+   void expand(int id);
+   // Must be called before a product state with ts_id is added
+   void mark_seen(int ts_id) const {
+      if (!ts_status || ts_status[ts_id].load(std::memory_order_relaxed) != UNSEEN) return;
+      char unseen = UNSEEN;
+      ts_status[ts_id].compare_exchange_strong(unseen, SEEN);
+   }
+   bool use_ample(int ts_id, std::vector<char> &in_ample) const;
+   // Call f(ts', nba') for every NBA successor of nba_id along the TS edge
+   // into i2
+   template <typename F>
+   void for_each_target(int i2, int nba_id, F f) const {
+      APMask label = ts->get_label(i2);
+      for (auto &group : nba_edges[nba_id]) {
+         if (!group.guard.holds(label, aps)) continue;
+         for (auto &j2 : group.targets) {
+            f(i2, j2);
+         }
+      }
+   }
+   // Call f(ts', nba') for every successor of the pair (ts_id, nba_id)
+   template <typename F>
+   void for_each_successor(int ts_id, int nba_id, F f) const {
+      for (auto &i2 : ts->get_successors(ts_id)) {
+         for_each_target(i2, nba_id, f);
+      }
+   }
+   // Call f(ts', nba') for every successor of the pair in the product of the
+   // reduced TS. in_ample is scratch space of the caller.
+   template <typename F>
+   void for_each_reduced_successor(int ts_id, int nba_id, std::vector<char> &in_ample, F f) const {
+      if (!partial_order || !use_ample(ts_id, in_ample)) {
+         for_each_successor(ts_id, nba_id, f);
+         return;
+      }
+      EdgeRange succ = ts->get_successors(ts_id);
+      for (int k = 0; k < succ.size(); ++k) {
+         if (in_ample[k]) for_each_target(succ[k], nba_id, f);
+      }
+   }
+ public:
+   Product(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba) : Product(ts, nba, ts->get_initial()) {}
+   // Use ts_initial instead of the initial states of the TS, so a TS can be
+   // checked from other states without copying it. The partial order, if
+   // any, must be for the formula of an automaton without X.
+   Product(std::shared_ptr<TS> ts, std::shared_ptr<NBA_base> nba, const std::vector<int> &ts_initial,
+           std::shared_ptr<const PartialOrder> partial_order = nullptr);
+   int get_state_count() const {
+      return states.size();
+   }
+   std::vector<int>& get_initial() {
+      return initial;
+   }
+   int get_ts_state(int id) const {
+      return StateTable::get_ts_id(states.get_key(id));
+   }
+   int get_edge_count() const {
+      return targets.size();
+   }
+   int get_nba_state(int id) const {
+      return StateTable::get_nba_id(states.get_key(id));
+   }
+   AcceptMask get_acceptance(int id) const {
+      return acceptance[get_nba_state(id)];
+   }
+   AcceptMask get_full_acceptance() const {
+      return full_acceptance;
+   }
+   // in every acceptance set, for an NBA simply accepting
+   bool is_accepting(int id) const {
+      return acceptance[get_nba_state(id)] == full_acceptance;
+   }
+   // bytes held by the states and the successor lists
+   uint64_t get_memory() const;
+   // Expanding other states may move the target array, so successors are
+   // accessed by index rather than through a pointer range
+   int get_successor_count(int id) {
+      if (succ_offset[id] < 0) expand(id);
+      return succ_count[id];
+   }
+   int get_successor(int id, int i) const {
+      return targets[succ_offset[id] + i];
+   }
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include "Bitset.hpp"
+#include "Reduction.hpp"
+
+namespace {
+
+// The states of an NBA or GNBA with the transitions as sorted target lists,
+// the guard of succ[q][i] in guards[q][i], and the acceptance sets as masks.
+// Ids are 0 .. n - 1.
+struct Automaton {
+   std::vector<bool> initial;
+   std::vector<std::vector<int>> succ;
+   std::vector<std::vector<Guard>> guards;
+   std::vector<AcceptMask> acceptance;
+   AcceptMask full_acceptance;
+   int size() const {
+      return succ.size();
+   }
+};
+
+// Mark the states of the non-trivial SCCs that meet every acceptance set,
+// i.e. the states on an accepting cycle. The SCCs are found with an
+// iterative Tarjan search.
+std::vector<bool> AcceptingCycleStates(const Automaton &a) {
+   int n = a.size();
+   std::vector<int> index(n, -1), low(n, 0);
+   std::vector<bool> on_stack(n, false), result(n, false);
+   std::vector<int> stack;
+   std::vector<std::pair<int, int>> call;
+   int time = 0;
+   for (int s = 0; s < n; ++s) {
+      if (index[s] != -1) continue;
+      index[s] = low[s] = time++;
+      stack.push_back(s);
+      on_stack[s] = true;
+      call.push_back(std::make_pair(s, 0));
+      while (!call.empty()) {
+         int v = call.back().first;
+         int i = call.back().second;
+         if (i < (int) a.succ[v].size()) {
+            ++call.back().second;
+            int w = a.succ[v][i];
+            if (index[w] == -1) {
+               index[w] = low[w] = time++;
+               stack.push_back(w);
+               on_stack[w] = true;
+               call.push_back(std::make_pair(w, 0));
+            } else if (on_stack[w]) {
+               low[v] = std::min(low[v], index[w]);
+            }
+            continue;
+         }
+         call.pop_back();
+         if (!call.empty()) {
+            int parent = call.back().first;
+            low[parent] = std::min(low[parent], low[v]);
+         }
+         if (low[v] != index[v]) continue;
+         std::vector<int> scc;
+         AcceptMask acceptance = 0;
+         int w;
+         do {
+            w = stack.back();
+            stack.pop_back();
+            on_stack[w] = false;
+            scc.push_back(w);
+            acceptance |= a.acceptance[w];
+         } while (w != v);
+         bool cyclic = scc.size() > 1 ||
+                       std::binary_search(a.succ[v].begin(), a.succ[v].end(), v);
+         if (!cyclic || acceptance != a.full_acceptance) continue;
+         for (auto &k : scc) {
+            result[k] = true;
+         }
+      }
+   }
+   return result;
+}
+
+// Keep the states reachable from an initial state that can reach an
+// accepting cycle. Returns the new id of every state, -1 if it is removed.
+std::vector<int> PruneStates(const Automaton &a) {
+   int n = a.size();
+   std::vector<bool> reachable(n, false);
+   std::vector<int> stack;
+   for (int i = 0; i < n; ++i) {
+      if (a.initial[i]) {
+         reachable[i] = true;
+         stack.push_back(i);
+      }
+   }
+   while (!stack.empty()) {
+      int v = stack.back();
+      stack.pop_back();
+      for (auto &w : a.succ[v]) {
+         if (!reachable[w]) {
+            reachable[w] = true;
+            stack.push_back(w);
+         }
+      }
+   }
+   std::vector<std::vector<int>> pred(n);
+   for (int v = 0; v < n; ++v) {
+      for (auto &w : a.succ[v]) {
+         pred[w].push_back(v);
+      }
+   }
+   std::vector<bool> useful = AcceptingCycleStates(a);
+   for (int i = 0; i < n; ++i) {
+      if (useful[i]) stack.push_back(i);
+   }
+   while (!stack.empty()) {
+      int v = stack.back();
+      stack.pop_back();
+      for (auto &w : pred[v]) {
+         if (!useful[w]) {
+            useful[w] = true;
+            stack.push_back(w);
+         }
+      }
+   }
+   std::vector<int> id(n, -1);
+   int count = 0;
+   for (int i = 0; i < n; ++i) {
+      if (reachable[i] && useful[i]) id[i] = count++;
+   }
+   return id;
+}
+
+// Compute the direct simulation: p simulates q if p is in every acceptance
+// set q is in, and for every transition q -g-> r there is a transition
+// p -h-> t where h allows every letter g allows and t simulates r. Starts
+// from the acceptance condition and removes pairs until the transition
+// condition holds everywhere.
+// Returns the class of every state under mutual simulation.
+std::vector<int> SimulationClasses(const Automaton &a) {
+   int n = a.size();
+   std::vector<Bitset> sim(n, Bitset(n));
+   std::vector<Bitset> succ(n, Bitset(n));
+   for (int q = 0; q < n; ++q) {
+      for (auto &r : a.succ[q]) {
+         succ[q].set(r);
+      }
+      for (int p = 0; p < n; ++p) {
+         if ((a.acceptance[q] & ~a.acceptance[p]) == 0) sim[q].set(p);
+      }
+   }
+   bool changed = true;
+   while (changed) {
+      changed = false;
+      for (int q = 0; q < n; ++q) {
+         for (int p = 0; p < n; ++p) {
+            if (p == q || !sim[q].test(p)) continue;
+            for (int i = 0; i < (int) a.succ[q].size(); ++i) {
+               int r = a.succ[q][i];
+               bool matched = false;
+               if (sim[r].intersects(succ[p])) {
+                  for (int j = 0; j < (int) a.succ[p].size() && !matched; ++j) {
+                     matched = sim[r].test(a.succ[p][j]) && a.guards[q][i].implies(a.guards[p][j]);
+                  }
+               }
+               if (!matched) {
+                  sim[q].reset(p);
+                  changed = true;
+                  break;
+               }
+            }
+         }
+      }
+   }
+   std::vector<int> cls(n, -1);
+   int count = 0;
+   for (int q = 0; q < n; ++q) {
+      if (cls[q] != -1) continue;
+      cls[q] = count;
+      for (int p = q + 1; p < n; ++p) {
+         if (cls[p] == -1 && sim[q].test(p) && sim[p].test(q)) cls[p] = count;
+      }
+      ++count;
+   }
+   return cls;
+}
+
+// Classes of states with the same initial flag, the same acceptance sets and
+// the same incoming transitions (source and guard). Such states can be
+// merged even if they lead to different successors: a run entering the
+// merged state can continue as any of them, and each of them could have been
+// entered the same way. This is what collapses the states of a state-based
+// construction that differ only in APs no predecessor constrains.
+std::vector<int> IncomingClasses(const Automaton &a) {
+   int n = a.size();
+   std::vector<std::vector<std::pair<int, Guard>>> incoming(n);
+   for (int q = 0; q < n; ++q) {
+      for (int i = 0; i < (int) a.succ[q].size(); ++i) {
+         incoming[a.succ[q][i]].push_back(std::make_pair(q, a.guards[q][i]));
+      }
+   }
+   typedef std::tuple<bool, AcceptMask, std::vector<std::pair<int, Guard>>> Key;
+   std::map<Key, int> classes;
+   std::vector<int> cls(n);
+   for (int q = 0; q < n; ++q) {
+      Key key(a.initial[q], a.acceptance[q], incoming[q]);
+      auto it = classes.find(key);
+      if (it == classes.end()) {
+         it = classes.insert(std::make_pair(key, (int) classes.size())).first;
+      }
+      cls[q] = it->second;
+   }
+   return cls;
+}
+
+// Build the automaton whose state k is made of the states q with map[q] == k.
+// The states of a class share their acceptance sets, and the guards of
+// transitions that end up between the same states are joined.
+Automaton Quotient(const Automaton &a, const std::vector<int> &map) {
+   int count = 0;
+   for (auto &k : map) {
+      count = std::max(count, k + 1);
+   }
+   std::vector<std::map<int, Guard>> transition(count);
+   Automaton b;
+   b.initial.assign(count, false);
+   b.acceptance.assign(count, 0);
+   b.full_acceptance = a.full_acceptance;
+   for (int q = 0; q < a.size(); ++q) {
+      int k = map[q];
+      if (k < 0) continue;
+      if (a.initial[q]) b.initial[k] = true;
+      b.acceptance[k] = a.acceptance[q];
+      for (int i = 0; i < (int) a.succ[q].size(); ++i) {
+         int r = map[a.succ[q][i]];
+         if (r < 0) continue;
+         auto it = transition[k].find(r);
+         if (it == transition[k].end()) {
+            transition[k][r] = a.guards[q][i];
+         } else {
+            it->second.add(a.guards[q][i]);
+         }
+      }
+   }
+   b.succ.resize(count);
+   b.guards.resize(count);
+   for (int k = 0; k < count; ++k) {
+      for (auto &e : transition[k]) {
+         b.succ[k].push_back(e.first);
+         b.guards[k].push_back(e.second);
+      }
+   }
+   return b;
+}
+
+// Prune, then merge states equivalent under simulation and states with the
+// same incoming transitions until nothing changes
+Automaton Reduce(std::shared_ptr<NBA_base> nba) {
+   Automaton a;
+   a.full_acceptance = nba->get_full_acceptance();
+   for (int i = 0; i < nba->get_node_count(); ++i) {
+      NBANodePtr node = nba->get_node(i);
+      a.initial.push_back(node->get_is_initial());
+      a.succ.push_back(std::vector<int>());
+      a.guards.push_back(std::vector<Guard>());
+      for (auto &e : node->get_transition()) {
+         a.succ.back().push_back(e.first);
+         a.guards.back().push_back(e.second);
+      }
+      a.acceptance.push_back(nba->get_acceptance(i));
+   }
+   a = Quotient(a, PruneStates(a));
+   int size;
+   do {
+      size = a.size();
+      a = Quotient(a, SimulationClasses(a));
+      a = Quotient(a, IncomingClasses(a));
+   } while (a.size() < size);
+   return a;
+}
+
+void AddStates(NBA_base &nba, const Automaton &a) {
+   for (int i = 0; i < a.size(); ++i) {
+      nba.add_node(i, a.initial[i] ? 1 : 0);
+   }
+   for (int i = 0; i < a.size(); ++i) {
+      for (int j = 0; j < (int) a.succ[i].size(); ++j) {
+         nba.add_transition(i, a.succ[i][j], a.guards[i][j]);
+      }
+   }
+}
+
+}
+
+std::shared_ptr<NBA> ReduceNBA(std::shared_ptr<NBA> nba) {
+   Automaton a = Reduce(nba);
+   std::shared_ptr<NBA> result = std::make_shared<NBA>();
+   AddStates(*result, a);
+   for (int i = 0; i < a.size(); ++i) {
+      if (a.acceptance[i]) result->add_accepting(i);
+   }
+   return result;
+}
+
+std::shared_ptr<GNBA> ReduceGNBA(std::shared_ptr<GNBA> gnba) {
+   Automaton a = Reduce(gnba);
+   std::shared_ptr<GNBA> result = std::make_shared<GNBA>();
+   AddStates(*result, a);
+   for (int k = 0; k < gnba->get_accepting_set_count(); ++k) {
+      std::set<int> accepting;
+      for (int i = 0; i < a.size(); ++i) {
+         if (a.acceptance[i] >> k & 1) accepting.insert(i);
+      }
+      result->add_accepting(accepting);
+   }
+   return result;
+}
@@ -0,0 +1,15 @@
+#ifndef REDUCTION_HPP
+#define REDUCTION_HPP
+
+#include "NBA.hpp"
+
+// Shrink an NBA before it is multiplied with the TS. States that are not
+// reachable from an initial state or cannot reach an accepting cycle are
+// removed, then states equivalent under direct simulation and states with
+// the same incoming transitions are merged.
+// The language of the NBA does not change.
+std::shared_ptr<NBA> ReduceNBA(std::shared_ptr<NBA> nba);
+// The same for a GNBA with at most MAX_ACCEPTING_SETS acceptance sets
+std::shared_ptr<GNBA> ReduceGNBA(std::shared_ptr<GNBA> gnba);
+
+#endif
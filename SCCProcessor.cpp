@@ -1,79 +1,148 @@
 #include "SCCProcessor.hpp"
 
-// Tarjan's algorithm for finding strongly connected components
-void SCCProcessor::tarjan(int node, int &time) {
-   dfn[node] = low[node] = ++time;
-   stk.push(node);
-   in_stack[node] = true;
-   for (std::vector<int>::size_type i = 0; i < edges[node].size(); ++i) {
-      int to = edges[node][i];
-      if (!dfn[to]) {
-         tarjan(to, time);
-         low[node] = std::min(low[node], low[to]);
-      } else if (in_stack[to]) {
-         low[node] = std::min(low[node], dfn[to]);
+// States are created while the product is explored, so the per-state arrays
+// have to grow with it
+void SCCProcessor::fit_size() {
+   if ((int) dfn.size() < prod->get_state_count()) {
+      dfn.resize(prod->get_state_count(), 0);
+      violating.resize(prod->get_state_count(), false);
+   }
+}
+
+void SCCProcessor::push(int node) {
+   dfn[node] = ++time;
+   roots.push_back(Root{dfn[node], prod->get_acceptance(node), false});
+   live.push_back(node);
+   dfs_stack.push_back(std::make_pair(node, 0));
+}
+
+// Breadth-first search from from, within the open SCC whose root has DFS
+// number root_dfn, for a state in one of the wanted acceptance sets or, if
+// goal >= 0, for goal. The path takes at least one edge and is appended to
+// path without from. Returns false if no such state is reachable.
+bool SCCProcessor::path_in_scc(int from, int root_dfn, AcceptMask wanted, int goal, std::vector<int> &path) {
+   std::unordered_map<int, int> parent;
+   std::vector<int> queue(1, from);
+   for (size_t head = 0; head < queue.size(); ++head) {
+      int node = queue[head];
+      for (int i = 0; i < prod->get_successor_count(node); ++i) {
+         int to = prod->get_successor(node, i);
+         if (dfn[to] < root_dfn || parent.count(to)) continue;
+         parent[to] = node;
+         if (to == goal || (goal < 0 && (prod->get_acceptance(to) & wanted))) {
+            std::vector<int> reversed;
+            for (int v = to; ; v = parent[v]) {
+               reversed.push_back(v);
+               if (parent[v] == from) break;
+            }
+            path.insert(path.end(), reversed.rbegin(), reversed.rend());
+            return true;
+         }
+         queue.push_back(to);
+      }
+   }
+   return false;
+}
+
+// The DFS stack is a path from an initial state through the root of the
+// accepting SCC. From the root, the cycle visits a state of every missing
+// acceptance set in turn and returns to the root.
+void SCCProcessor::make_lasso(int root_dfn) {
+   fit_size();
+   lasso->prefix.clear();
+   lasso->cycle.clear();
+   int root = -1;
+   for (auto &frame : dfs_stack) {
+      if (dfn[frame.first] == root_dfn) {
+         root = frame.first;
+         break;
       }
+      lasso->prefix.push_back(frame.first);
    }
-   if (dfn[node] == low[node]) {
-      scc.push_back(std::set<int>());
-      int top;
-      do {
-         top = stk.top();
-         stk.pop();
-         in_stack[top] = false;
-         scc.back().insert(top);
-         scc_belong[top] = ((int) scc.size()) - 1;
-      } while (top != node);
+   lasso->cycle.push_back(root);
+   AcceptMask missing = prod->get_full_acceptance() & ~prod->get_acceptance(root);
+   while (missing && path_in_scc(lasso->cycle.back(), root_dfn, missing, -1, lasso->cycle)) {
+      missing &= ~prod->get_acceptance(lasso->cycle.back());
    }
+   path_in_scc(lasso->cycle.back(), root_dfn, 0, root, lasso->cycle);
+   lasso->cycle.pop_back();
 }
 
-void SCCProcessor::calc_scc() {
-   dfn = std::vector<int>(node_count, 0);
-   low = std::vector<int>(node_count, 0);
-   scc_belong = std::vector<int>(node_count, 0);
-   in_stack = std::vector<bool>(node_count, false);
-   int time = 0;
-   for (int i = 0; i < node_count; ++i) {
-      if (!dfn[i]) {
-         tarjan(i, time);
+// With stop_at_cycle the search returns true at the first accepting cycle.
+// Otherwise it explores every reachable state, and SCCs are closed in reverse
+// topological order, so when an SCC is closed it is known whether an
+// accepting cycle is reachable from it.
+bool SCCProcessor::search(int init, bool stop_at_cycle) {
+   push(init);
+   while (!dfs_stack.empty()) {
+      int node = dfs_stack.back().first;
+      int &next = dfs_stack.back().second;
+      if (next < prod->get_successor_count(node)) {
+         int to = prod->get_successor(node, next++);
+         fit_size();
+         if (dfn[to] == 0) {
+            push(to);
+         } else if (dfn[to] > 0) {
+            // to is in an open SCC: merge every SCC whose root was reached after it
+            Root merged = roots.back();
+            while (roots.back().dfn > dfn[to]) {
+               merged.acceptance |= roots.back().acceptance;
+               merged.violating = merged.violating || roots.back().violating;
+               roots.pop_back();
+            }
+            roots.back().acceptance |= merged.acceptance;
+            bool accepting = roots.back().acceptance == prod->get_full_acceptance();
+            roots.back().violating = roots.back().violating || merged.violating || accepting;
+            if (accepting && stop_at_cycle) {
+               if (lasso) make_lasso(roots.back().dfn);
+               return true;
+            }
+         } else if (violating[to]) {
+            roots.back().violating = true;
+         }
+         continue;
+      }
+      dfs_stack.pop_back();
+      if (roots.back().dfn == dfn[node]) {
+         // node is the root of its SCC
+         bool scc_violating = roots.back().violating;
+         roots.pop_back();
+         int top;
+         do {
+            top = live.back();
+            live.pop_back();
+            dfn[top] = -1;
+            violating[top] = scc_violating;
+         } while (top != node);
+         if (scc_violating && !roots.empty()) {
+            roots.back().violating = true;
+         }
       }
    }
+   return false;
 }
 
-// Check if a strongly connected component contains a circle
-bool SCCProcessor::scc_contains_circle(int id) {
-   std::set<int> scc_set = scc[id];
-   if (scc_set.size() > 1) {
-      return true;
-   } else if (scc_set.size() == 1) {
-      int node = *scc_set.begin();
-      return has_self_loop[node];
+// Only the SCCs reachable from the initial states are computed
+bool SCCProcessor::find_accepting_scc(Lasso *lasso) {
+   this->lasso = lasso;
+   for (auto &i : prod->get_initial()) {
+      fit_size();
+      if (dfn[i] == 0 && search(i, true)) {
+         return true;
+      }
    }
    return false;
 }
 
-// Find all nodes reachable from a set of nodes
-std::vector<int> SCCProcessor::reachable_from(std::vector<int> nodes) {
-   std::vector<int> reachable;
-   std::vector<bool> visited(node_count, false);
-   for (std::vector<int>::size_type i = 0; i < nodes.size(); ++i) {
-      if (!visited[nodes[i]]) {
-         std::stack<int> stk;
-         stk.push(nodes[i]);
-         visited[nodes[i]] = true;
-         while (!stk.empty()) {
-            int node = stk.top();
-            stk.pop();
-            reachable.push_back(node);
-            for (std::vector<int>::size_type j = 0; j < edges[node].size(); ++j) {
-               int to = edges[node][j];
-               if (!visited[to]) {
-                  stk.push(to);
-                  visited[to] = true;
-               }
-            }
-         }
+// For every product state reachable from the initial states, whether an
+// accepting cycle is reachable from it, computed in one search
+std::vector<bool> SCCProcessor::find_violating_states() {
+   for (auto &i : prod->get_initial()) {
+      fit_size();
+      if (dfn[i] == 0) {
+         search(i, false);
       }
    }
-   return reachable;
-}
\ No newline at end of file
+   fit_size();
+   return violating;
+}
@@ -1,35 +1,50 @@
 #ifndef SCCPROCESSOR_HPP
 #define SCCPROCESSOR_HPP
 
-#include <set>
-#include <stack>
 #include <vector>
+#include <utility>
+#include <unordered_map>
+#include "Product.hpp"
 
 // Strongly Connected Component Processor
+// Couvreur's on-the-fly SCC algorithm: a DFS from the initial states keeps a
+// stack with the root of every SCC that is still open. An edge to a state of
+// an open SCC merges all SCCs above it into one, and since that edge closes a
+// cycle, a merged SCC with an accepting state has an accepting cycle. For a
+// GNBA product, the SCC is accepting once it covers every acceptance set.
+// The search is iterative, so it is safe on products with millions of states.
 class SCCProcessor {
  private:
-   int node_count;
-   std::vector<bool> has_self_loop;
-   std::vector<int> dfn, low, scc_belong;
-   std::vector<std::vector<int>> edges;
-   std::vector<std::set<int>> scc;
-   std::vector<bool> in_stack;
-   std::stack<int> stk;
-   void tarjan(int node, int &time);
+   struct Root {
+      int dfn;
+      // the acceptance sets of the states in the SCC
+      AcceptMask acceptance;
+      // an accepting cycle is reachable from the SCC
+      bool violating;
+   };
+   std::shared_ptr<Product> prod;
+   // 0: not reached, > 0: DFS number of a state in an open SCC, -1: SCC closed
+   std::vector<int> dfn;
+   // an accepting cycle is reachable from the state, set when its SCC is closed
+   std::vector<bool> violating;
+   std::vector<Root> roots;
+   // states of the open SCCs, in the order they were reached
+   std::vector<int> live;
+   std::vector<std::pair<int, int>> dfs_stack;
+   int time;
+   // filled in when an accepting SCC is found, if not null
+   Lasso *lasso;
+   void fit_size();
+   void push(int node);
+   bool path_in_scc(int from, int root_dfn, AcceptMask wanted, int goal, std::vector<int> &path);
+   void make_lasso(int root_dfn);
+   bool search(int init, bool stop_at_cycle);
  public:
-   SCCProcessor(int node_count) : node_count(node_count), has_self_loop(node_count), edges(node_count) {}
-   void add_edge(int from, int to) {
-      edges[from].push_back(to);
-      if (from == to) {
-         has_self_loop[from] = true;
-      }
-   }
-   int get_scc_belong(int node) {
-      return scc_belong[node];
-   }
-   void calc_scc();
-   bool scc_contains_circle(int id);
-   std::vector<int> reachable_from(std::vector<int>);
+   SCCProcessor(std::shared_ptr<Product> prod) : prod(prod), time(0), lasso(nullptr) {}
+   // With a lasso, the prefix is read off the DFS stack when the SCC is found
+   // and the cycle is closed by searching within that SCC only
+   bool find_accepting_scc(Lasso *lasso = nullptr);
+   std::vector<bool> find_violating_states();
 };
 
-#endif
\ No newline at end of file
+#endif
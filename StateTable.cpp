@@ -0,0 +1,44 @@
+#include "StateTable.hpp"
+
+StateTable::StateTable() : slots(new uint32_t[1024]()), capacity(1024) {}
+
+int StateTable::find(uint64_t key) const {
+   uint64_t mask = capacity - 1;
+   for (uint64_t i = MixKey(key) & mask; slots[i] != 0; i = (i + 1) & mask) {
+      if (keys[slots[i] - 1] == key) return slots[i] - 1;
+   }
+   return -1;
+}
+
+int StateTable::find_or_add(uint64_t key) {
+   uint64_t mask = capacity - 1;
+   uint64_t i = MixKey(key) & mask;
+   for (; slots[i] != 0; i = (i + 1) & mask) {
+      if (keys[slots[i] - 1] == key) return slots[i] - 1;
+   }
+   int id = keys.size();
+   keys.push_back(key);
+   slots[i] = id + 1;
+   if (keys.size() * 4 > capacity * 3) grow();
+   return id;
+}
+
+// Every id is put back where the doubled table probes for its key
+void StateTable::grow() {
+   capacity <<= 1;
+   slots.reset(new uint32_t[capacity]());
+   uint64_t mask = capacity - 1;
+   for (size_t id = 0; id < keys.size(); ++id) {
+      uint64_t i = MixKey(keys[id]) & mask;
+      while (slots[i] != 0) {
+         i = (i + 1) & mask;
+      }
+      slots[i] = id + 1;
+   }
+}
+
+void StateTable::assign(std::vector<uint64_t> &&keys) {
+   this->keys = std::move(keys);
+   slots.reset();
+   capacity = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef STATE_TABLE_HPP
+#define STATE_TABLE_HPP
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// splitmix64 finalizer, the hash of the packed state keys
+inline uint64_t MixKey(uint64_t key) {
+   key ^= key >> 30;
+   key *= 0xbf58476d1ce4e5b9ULL;
+   key ^= key >> 27;
+   key *= 0x94d049bb133111ebULL;
+   return key ^ (key >> 31);
+}
+
+// The states of a product, numbered in the order they are added.
+// A state (s, q) is packed into one 64-bit key, and the keys are stored by
+// id. The index from keys to ids is an open-addressing table with linear
+// probing whose slots hold id + 1, so 0 marks an empty slot and a probe
+// compares the key stored for the id. A state takes its 8-byte key and one
+// 4-byte slot per 3/4 of load, where a node-based map takes several times
+// that.
+class StateTable {
+ private:
+   std::vector<uint64_t> keys;
+   std::unique_ptr<uint32_t[]> slots;
+   uint64_t capacity;
+   void grow();
+ public:
+   StateTable();
+   static uint64_t pack(int ts_id, int nba_id) {
+      return ((uint64_t) ts_id << 32) | (uint32_t) nba_id;
+   }
+   static int get_ts_id(uint64_t key) {
+      return key >> 32;
+   }
+   static int get_nba_id(uint64_t key) {
+      return (uint32_t) key;
+   }
+   // The id of the key, or -1
+   int find(uint64_t key) const;
+   // The id of the key, added as the next id if it is new
+   int find_or_add(uint64_t key);
+   // Replace the states by the given keys, numbered in that order, without
+   // an index: for a product that is expanded completely and looks nothing up
+   void assign(std::vector<uint64_t> &&keys);
+   uint64_t get_key(int id) const {
+      return keys[id];
+   }
+   int size() const {
+      return keys.size();
+   }
+   // bytes held by the keys and the index
+   uint64_t get_memory() const {
+      return keys.capacity() * sizeof(uint64_t) + capacity * sizeof(uint32_t);
+   }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <sys/resource.h>
+
+// A string as a quoted JSON string, control characters included
+inline std::string JSONString(const std::string &value) {
+   std::string quoted = "\"";
+   for (auto &c : value) {
+      if (c == '\\' || c == '"') {
+         quoted += '\\';
+         quoted += c;
+      } else if (c == '\n') {
+         quoted += "\\n";
+      } else if (c == '\r') {
+         quoted += "\\r";
+      } else if (c == '\t') {
+         quoted += "\\t";
+      } else if ((unsigned char) c < 0x20) {
+         char code[8];
+         snprintf(code, sizeof(code), "\\u%04x", (unsigned char) c);
+         quoted += code;
+      } else {
+         quoted += c;
+      }
+   }
+   return quoted + "\"";
+}
+
+// Statistics of one query, written as one JSON object. The fields keep the
+// order they were added in. The stages take a Stats pointer that is null
+// unless --stats is given, so nothing is measured otherwise.
+class Stats {
+ private:
+   // name and JSON value
+   std::vector<std::pair<std::string, std::string>> fields;
+ public:
+   void add(const std::string &name, double value) {
+      std::ostringstream os;
+      if (value == (long long) value) {
+         os << (long long) value;
+      } else {
+         os.setf(std::ios::fixed);
+         os.precision(3);
+         os << value;
+      }
+      fields.push_back(std::make_pair(name, os.str()));
+   }
+   void add_bool(const std::string &name, bool value) {
+      fields.push_back(std::make_pair(name, value ? "true" : "false"));
+   }
+   void add_string(const std::string &name, const std::string &value) {
+      fields.push_back(std::make_pair(name, JSONString(value)));
+   }
+   void append(const Stats &other) {
+      fields.insert(fields.end(), other.fields.begin(), other.fields.end());
+   }
+   void write(std::ostream &os) const {
+      os << "{";
+      for (int i = 0; i < (int) fields.size(); ++i) {
+         os << (i ? ", \"" : "\"") << fields[i].first << "\": " << fields[i].second;
+      }
+      os << "}\n";
+   }
+};
+
+// Records the time of consecutive stages as <stage>_ms, without a Stats it
+// does not even read the clock
+class StageTimer {
+ private:
+   Stats *stats;
+   std::chrono::steady_clock::time_point last;
+ public:
+   StageTimer(Stats *stats) : stats(stats) {
+      if (stats) last = std::chrono::steady_clock::now();
+   }
+   // The time since the previous stage, or since the timer was made
+   void stage(const std::string &name) {
+      if (!stats) return;
+      auto now = std::chrono::steady_clock::now();
+      stats->add(name + "_ms", std::chrono::duration<double, std::milli>(now - last).count());
+      last = now;
+   }
+};
+
+// The peak resident memory of the process so far
+inline long PeakRSSKilobytes() {
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
+#endif
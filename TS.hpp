@@ -2,60 +2,81 @@
 #define TS_HPP
 
 #include <set>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
 #include <iostream>
+#include "AP.hpp"
+#include "Graph.hpp"
 
-class TSNode {
- private:
-   int id;
-   int is_initial;
-   std::set<std::string> ap;
-   std::set<int> transition;
- public:
-   TSNode() {}
-   TSNode(int id, int is_initial, const std::set<std::string> &ap) : id(id), is_initial(is_initial), ap(ap) {}
-   TSNode(const TSNode &node) : id(node.id), is_initial(node.is_initial), ap(node.ap), transition(node.transition) {}
-   int get_id() const {
-      return id;
-   }
-   int get_is_initial() const {
-      return is_initial;
-   }
-   std::set<std::string>& get_ap() {
-      return ap;
-   }
-   std::set<int>& get_transition() {
-      return transition;
-   }
-};
-
-typedef std::shared_ptr<TSNode> TSNodePtr;
+class PartialOrder;
 
+// The transitions are stored in a shared CSR graph and the node labels in a
+// shared array, so copies of a TS and the product built on top of it reuse
+// them, and both can point into a mapped binary file.
+// Node labels are bitmasks over the APs interned in ap_table.
+// The action numbers of the transitions are kept in a second CSR graph with
+// a row per edge of the transition graph: row e lists the actions of the
+// e-th edge, so parallel edges with different actions stay one edge.
 class TS {
  private:
    int node_count;
    std::vector<int> initial;
-   std::vector<TSNodePtr> nodes;
-   std::set<std::string> ap;
+   std::shared_ptr<const APMask> labels;
+   APMask ap;
+   APTablePtr ap_table;
+   GraphPtr graph;
+   GraphPtr actions;
+   // set with --por, see PartialOrder.hpp
+   std::shared_ptr<const PartialOrder> partial_order;
  public:
-   TS() : node_count(0) {}
-   TS(int node_count) : node_count(node_count) {}
-   TS(const TS &ts) : node_count(ts.node_count), initial(ts.initial), ap(ts.ap) {
-      for (auto &node : ts.nodes) {
-         nodes.push_back(std::make_shared<TSNode>(*node));
-      }
+   TS() : node_count(0), ap(0), ap_table(std::make_shared<APTable>()), graph(std::make_shared<const Graph>()),
+          actions(std::make_shared<const Graph>()) {}
+   TS(const TS &ts) : node_count(ts.node_count), initial(ts.initial), labels(ts.labels), ap(ts.ap),
+                      ap_table(ts.ap_table), graph(ts.graph), actions(ts.actions),
+                      partial_order(ts.partial_order) {}
+   // Take the label of every node from an array, which may alias memory
+   // owned by another object
+   void set_labels(int node_count, std::shared_ptr<const APMask> labels) {
+      this->node_count = node_count;
+      this->labels = labels;
    }
-   void add_node(TSNodePtr node) {
-      ++node_count;
-      nodes.push_back(node);
-      if (node->get_is_initial()) {
-         initial.push_back(node->get_id());
-      }
+   // Take the labels from a vector
+   void set_labels(std::vector<APMask> labels) {
+      auto owner = std::make_shared<const std::vector<APMask>>(std::move(labels));
+      set_labels(owner->size(), std::shared_ptr<const APMask>(owner, owner->data()));
+   }
+   const APMask* get_labels() const {
+      return labels.get();
+   }
+   void set_initial(std::vector<int> initial) {
+      this->initial = std::move(initial);
+   }
+   void set_graph(GraphPtr graph) {
+      this->graph = graph;
    }
-   void add_transition(int from, int to) {
-      nodes[from]->get_transition().insert(to);
+   GraphPtr get_graph() const {
+      return graph;
+   }
+   void set_actions(GraphPtr actions) {
+      this->actions = actions;
+   }
+   GraphPtr get_actions() const {
+      return actions;
+   }
+   // Whether every edge has its actions, a TS without actions has none
+   bool has_actions() const {
+      return actions->get_node_count() == graph->get_edge_count() && graph->get_edge_count() > 0;
+   }
+   void set_partial_order(std::shared_ptr<const PartialOrder> partial_order) {
+      this->partial_order = partial_order;
+   }
+   std::shared_ptr<const PartialOrder> get_partial_order() const {
+      return partial_order;
+   }
+   EdgeRange get_successors(int id) const {
+      return graph->get_successors(id);
    }
    int get_node_count() const {
       return node_count;
@@ -63,28 +84,20 @@ class TS {
    std::vector<int>& get_initial() {
       return initial;
    }
-   TSNodePtr get_node(int id) const {
-      return nodes[id];
+   APMask get_label(int id) const {
+      return labels.get()[id];
    }
-   std::set<std::string>& get_ap() {
+   APMask get_ap() const {
       return ap;
    }
-   void set_ap(const std::set<std::string> &ap) {
+   void set_ap(APMask ap) {
       this->ap = ap;
-   } 
-   std::shared_ptr<TS> adjust_initial(int id) {
-      std::shared_ptr<TS> ts = std::make_shared<TS>();
-      ts->set_ap(ap);
-      for (int i = 0; i < node_count; ++i) {
-         TSNodePtr node = std::make_shared<TSNode>(nodes[i]->get_id(), nodes[i]->get_id() == id, std::set<std::string>(nodes[i]->get_ap()));
-         ts->add_node(node);
-      }
-      for (int i = 0; i < node_count; ++i) {
-         for (auto &to : nodes[i]->get_transition()) {
-            ts->add_transition(nodes[i]->get_id(), to);
-         }
-      }
-      return ts;
+   }
+   APTablePtr get_ap_table() const {
+      return ap_table;
+   }
+   void set_ap_table(APTablePtr ap_table) {
+      this->ap_table = ap_table;
    }
    void print() {
       std::cout << "-----------------TS print begin-----------------" << std::endl;
@@ -95,14 +108,14 @@ class TS {
       std::cout << std::endl;
       for (int i = 0; i < node_count; ++i) {
          std::cout << "node " << i << ": ";
-         std::cout << "is_initial: " << nodes[i]->get_is_initial() << ' ';
+         std::cout << "is_initial: " << (std::find(initial.begin(), initial.end(), i) != initial.end()) << ' ';
          std::cout << "ap: ";
-         for (auto &ap : nodes[i]->get_ap()) {
+         for (auto &ap : ap_table->get_names(get_label(i))) {
             std::cout << ap << ' ';
          }
          std::cout << std::endl;
          std::cout << "transition: ";
-         for (auto &to : nodes[i]->get_transition()) {
+         for (auto &to : get_successors(i)) {
             std::cout << to << ' ';
          }
          std::cout << std::endl;
@@ -111,4 +124,4 @@ class TS {
    }
 };
 
-#endif
\ No newline at end of file
+#endif
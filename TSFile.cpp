@@ -0,0 +1,178 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "TSFile.hpp"
+
+namespace {
+
+const char MAGIC[8] = {'L', 'T', 'L', 'T', 'S', 'B', 'I', 'N'};
+const uint32_t VERSION = 2;
+
+uint64_t Align(uint64_t size) {
+   return (size + 7) / 8 * 8;
+}
+
+// Byte offsets of the sections after the header
+struct Layout {
+   uint64_t names;
+   uint64_t labels;
+   uint64_t offsets;
+   uint64_t targets;
+   uint64_t initial;
+   uint64_t action_offsets;
+   uint64_t actions;
+   uint64_t end;
+   Layout(const TSFileHeader &header) {
+      names = Align(sizeof(TSFileHeader));
+      labels = names + Align(header.names_size);
+      offsets = labels + Align(header.node_count * sizeof(APMask));
+      targets = offsets + Align((header.node_count + 1) * sizeof(int));
+      initial = targets + Align(header.edge_count * sizeof(int));
+      action_offsets = initial + Align(header.initial_count * sizeof(int));
+      actions = action_offsets + Align((header.edge_count + 1) * sizeof(int));
+      end = actions + Align(header.action_count * sizeof(int));
+   }
+};
+
+bool WriteAt(FILE *file, uint64_t position, const void *data, uint64_t size) {
+   return fseek(file, position, SEEK_SET) == 0 && (size == 0 || fwrite(data, size, 1, file) == 1);
+}
+
+}
+
+bool IsBinaryTS(const std::string &path) {
+   char magic[sizeof(MAGIC)];
+   FILE *file = fopen(path.c_str(), "rb");
+   if (!file) return false;
+   bool binary = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+   fclose(file);
+   return binary;
+}
+
+std::shared_ptr<TS> LoadBinaryTS(const std::string &path) {
+   int fd = open(path.c_str(), O_RDONLY);
+   if (fd < 0) {
+      failwith("cannot open %s\n", path.c_str());
+      return nullptr;
+   }
+   struct stat st;
+   if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(TSFileHeader)) {
+      close(fd);
+      failwith("%s is not a binary TS file\n", path.c_str());
+      return nullptr;
+   }
+   uint64_t size = st.st_size;
+   void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED) {
+      failwith("cannot map %s\n", path.c_str());
+      return nullptr;
+   }
+   std::shared_ptr<const void> mapping(data, [size](const void *p) {
+      munmap(const_cast<void*>(p), size);
+   });
+   const char *base = (const char*) data;
+   const TSFileHeader &header = *(const TSFileHeader*) base;
+   if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+      failwith("%s is not a binary TS file of version %u\n", path.c_str(), VERSION);
+      return nullptr;
+   }
+   // bound every size before the layout adds them up, so the sums cannot wrap
+   if (header.ap_count > (uint64_t) MAX_AP || header.node_count >= (1ull << 31) ||
+       header.edge_count >= (1ull << 31) || header.action_count >= (1ull << 31) ||
+       header.initial_count > header.node_count || header.names_size > size) {
+      failwith("%s is truncated or too large\n", path.c_str());
+      return nullptr;
+   }
+   Layout layout(header);
+   if (layout.end > size) {
+      failwith("%s is truncated or too large\n", path.c_str());
+      return nullptr;
+   }
+   int node_count = header.node_count;
+   const int *offsets = (const int*) (base + layout.offsets);
+   const int *action_offsets = (const int*) (base + layout.action_offsets);
+   if (offsets[0] != 0 || offsets[node_count] != (int) header.edge_count ||
+       action_offsets[0] != 0 || action_offsets[header.edge_count] != (int) header.action_count) {
+      failwith("%s has inconsistent offsets\n", path.c_str());
+      return nullptr;
+   }
+   // only the initial states are checked, so loading stays independent of the size
+   const int *initial = (const int*) (base + layout.initial);
+   for (uint64_t i = 0; i < header.initial_count; ++i) {
+      if (initial[i] < 0 || initial[i] >= node_count) {
+         failwith("%s has invalid initial states\n", path.c_str());
+         return nullptr;
+      }
+   }
+   std::shared_ptr<TS> ts = std::make_shared<TS>();
+   // the table of a new TS is empty, so the i-th name gets bit i, as in the file
+   const char *name = base + layout.names;
+   const char *names_end = name + header.names_size;
+   for (uint32_t i = 0; i < header.ap_count; ++i) {
+      const char *end = (const char*) memchr(name, '\0', names_end - name);
+      if (!end) {
+         failwith("%s has malformed AP names\n", path.c_str());
+         return nullptr;
+      }
+      ts->get_ap_table()->intern(std::string(name, end));
+      name = end + 1;
+   }
+   ts->set_ap(header.ap_count == MAX_AP ? ~(APMask) 0 : APBit(header.ap_count) - 1);
+   ts->set_labels(node_count, std::shared_ptr<const APMask>(mapping, (const APMask*) (base + layout.labels)));
+   ts->set_graph(std::make_shared<const Graph>(node_count, header.edge_count, offsets,
+                                               (const int*) (base + layout.targets), mapping));
+   ts->set_actions(std::make_shared<const Graph>(header.edge_count, header.action_count, action_offsets,
+                                                 (const int*) (base + layout.actions), mapping));
+   ts->set_initial(std::vector<int>(initial, initial + header.initial_count));
+   return ts;
+}
+
+bool SaveBinaryTS(std::shared_ptr<TS> ts, const std::string &path) {
+   GraphPtr graph = ts->get_graph();
+   // a TS without actions gets empty rows
+   GraphPtr actions = ts->has_actions() ? ts->get_actions() : GraphPtr(
+      std::make_shared<const Graph>(std::vector<int>(graph->get_edge_count() + 1, 0), std::vector<int>()));
+   std::string names;
+   int ap_count = ts->get_ap_table()->size();
+   for (int i = 0; i < ap_count; ++i) {
+      names += ts->get_ap_table()->get_name(i);
+      names += '\0';
+   }
+   TSFileHeader header;
+   memcpy(header.magic, MAGIC, sizeof(MAGIC));
+   header.version = VERSION;
+   header.ap_count = ap_count;
+   header.node_count = ts->get_node_count();
+   header.edge_count = graph->get_edge_count();
+   header.initial_count = ts->get_initial().size();
+   header.names_size = names.size();
+   header.action_count = actions->get_edge_count();
+   Layout layout(header);
+   FILE *file = fopen(path.c_str(), "wb");
+   if (!file) {
+      failwith("cannot write %s\n", path.c_str());
+      return false;
+   }
+   bool ok = WriteAt(file, 0, &header, sizeof(header)) &&
+             WriteAt(file, layout.names, names.data(), names.size()) &&
+             WriteAt(file, layout.labels, ts->get_labels(), header.node_count * sizeof(APMask)) &&
+             WriteAt(file, layout.offsets, graph->get_offsets(), (header.node_count + 1) * sizeof(int)) &&
+             WriteAt(file, layout.targets, graph->get_targets(), header.edge_count * sizeof(int)) &&
+             WriteAt(file, layout.initial, ts->get_initial().data(), header.initial_count * sizeof(int)) &&
+             WriteAt(file, layout.action_offsets, actions->get_offsets(), (header.edge_count + 1) * sizeof(int)) &&
+             WriteAt(file, layout.actions, actions->get_targets(), header.action_count * sizeof(int));
+   // pad the last sections, so the file size matches the layout
+   if (ok && fseek(file, 0, SEEK_END) == 0 && (uint64_t) ftell(file) < layout.end) {
+      char zero = 0;
+      ok = WriteAt(file, layout.end - 1, &zero, 1);
+   }
+   ok = fclose(file) == 0 && ok;
+   if (!ok) {
+      failwith("cannot write %s\n", path.c_str());
+   }
+   return ok;
+}
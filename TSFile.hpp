@@ -0,0 +1,41 @@
+#ifndef TS_FILE_HPP
+#define TS_FILE_HPP
+
+#include <string>
+#include <memory>
+#include "TS.hpp"
+
+// Binary TS format, read in place through mmap.
+// All numbers are in native byte order. After the header come, each section
+// starting at a multiple of 8 bytes:
+//  - the AP names, each terminated by '\0', names_size bytes
+//  - the label of every node, node_count 64-bit masks, bit i for the i-th name
+//  - the CSR offsets, node_count + 1 32-bit ints
+//  - the CSR targets, edge_count 32-bit ints, every row sorted and unique
+//  - the initial states, initial_count 32-bit ints
+//  - the CSR offsets of the actions, edge_count + 1 32-bit ints
+//  - the action numbers, action_count 32-bit ints, row e for the e-th edge
+// Loading only checks the header and the section sizes, so it costs the
+// same for any model size; the pages are read when the search touches them.
+struct TSFileHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t ap_count;
+   uint64_t node_count;
+   uint64_t edge_count;
+   uint64_t initial_count;
+   uint64_t names_size;
+   uint64_t action_count;
+};
+
+// Whether the file starts with the magic of the binary format
+bool IsBinaryTS(const std::string &path);
+
+// Map a binary TS file. The TS keeps the mapping alive. Returns nullptr and
+// prints the reason on a malformed file.
+std::shared_ptr<TS> LoadBinaryTS(const std::string &path);
+
+// Write a TS in the binary format. Returns false if the file cannot be written.
+bool SaveBinaryTS(std::shared_ptr<TS> ts, const std::string &path);
+
+#endif
@@ -0,0 +1,251 @@
+#include <map>
+#include <tuple>
+#include "Tableau.hpp"
+
+namespace {
+
+// Formulas in negation normal form: negation only occurs in front of an AP.
+// R (release) is the dual of U: a R b = !(!a U !b)
+enum class NNFType {
+   TRUE, FALSE, LIT, NEG_LIT, AND, OR, NEXT, UNTIL, RELEASE
+};
+
+// For LIT and NEG_LIT, left holds the AP id, negative for an AP outside the TS
+struct NNF {
+   NNFType type;
+   int left;
+   int right;
+};
+
+// Hash-consed NNF formulas, so a formula is identified by its id
+class NNFTable {
+ private:
+   std::vector<NNF> formulas;
+   std::map<std::tuple<NNFType, int, int>, int> ids;
+ public:
+   int make(NNFType type, int left = -1, int right = -1) {
+      auto key = std::make_tuple(type, left, right);
+      auto it = ids.find(key);
+      if (it != ids.end()) {
+         return it->second;
+      }
+      formulas.push_back(NNF{type, left, right});
+      ids[key] = formulas.size() - 1;
+      return formulas.size() - 1;
+   }
+   // -1 if the formula was never made
+   int find(NNFType type, int left = -1, int right = -1) const {
+      auto it = ids.find(std::make_tuple(type, left, right));
+      return it == ids.end() ? -1 : it->second;
+   }
+   const NNF& get(int id) const {
+      return formulas[id];
+   }
+   int size() const {
+      return formulas.size();
+   }
+};
+
+// Push the negations of expr down to the APs
+int ToNNF(NNFTable &table, const ExprPtr &expr, bool negated) {
+   switch (expr->get_type()) {
+      case ExprType::TRUE:
+         return table.make(negated ? NNFType::FALSE : NNFType::TRUE);
+      case ExprType::VAR: {
+         VarExpr &var_expr = static_cast<VarExpr&>(*expr);
+         // an AP outside the TS has no id; a negative one per name keeps the
+         // literals of different names apart and out of the guards
+         int ap = var_expr.get_ap_id() >= 0 ? var_expr.get_ap_id() : -1 - var_expr.get_id();
+         return table.make(negated ? NNFType::NEG_LIT : NNFType::LIT, ap);
+      }
+      case ExprType::NEG:
+         return ToNNF(table, static_cast<UnaryExpr&>(*expr).get_expr(), !negated);
+      case ExprType::NEXT:
+         return table.make(NNFType::NEXT, ToNNF(table, static_cast<UnaryExpr&>(*expr).get_expr(), negated));
+      case ExprType::ALWAYS: {
+         int sub = ToNNF(table, static_cast<UnaryExpr&>(*expr).get_expr(), negated);
+         if (negated) return table.make(NNFType::UNTIL, table.make(NNFType::TRUE), sub);
+         return table.make(NNFType::RELEASE, table.make(NNFType::FALSE), sub);
+      }
+      case ExprType::EVENTUALLY: {
+         int sub = ToNNF(table, static_cast<UnaryExpr&>(*expr).get_expr(), negated);
+         if (negated) return table.make(NNFType::RELEASE, table.make(NNFType::FALSE), sub);
+         return table.make(NNFType::UNTIL, table.make(NNFType::TRUE), sub);
+      }
+      default:
+         break;
+   }
+   BinaryExpr &binary_expr = static_cast<BinaryExpr&>(*expr);
+   switch (expr->get_type()) {
+      case ExprType::CONJ: {
+         int left = ToNNF(table, binary_expr.get_left(), negated);
+         int right = ToNNF(table, binary_expr.get_right(), negated);
+         return table.make(negated ? NNFType::OR : NNFType::AND, left, right);
+      }
+      case ExprType::DISJ: {
+         int left = ToNNF(table, binary_expr.get_left(), negated);
+         int right = ToNNF(table, binary_expr.get_right(), negated);
+         return table.make(negated ? NNFType::AND : NNFType::OR, left, right);
+      }
+      case ExprType::IMPL: {
+         int left = ToNNF(table, binary_expr.get_left(), !negated);
+         int right = ToNNF(table, binary_expr.get_right(), negated);
+         return table.make(negated ? NNFType::AND : NNFType::OR, left, right);
+      }
+      case ExprType::UNTIL: {
+         int left = ToNNF(table, binary_expr.get_left(), negated);
+         int right = ToNNF(table, binary_expr.get_right(), negated);
+         return table.make(negated ? NNFType::RELEASE : NNFType::UNTIL, left, right);
+      }
+      default:
+         failwith("unexpected expression type in tableau translation\n");
+         exit(EXIT_FAILURE);
+   }
+}
+
+// A tableau node: the formulas still to be processed now (fresh), the ones
+// already processed (old) and the obligations for the next step (next).
+// incoming holds the finished nodes with an edge into this one, INIT for the
+// initial obligation.
+const int INIT = -1;
+
+struct TableauNode {
+   std::set<int> incoming;
+   std::vector<int> fresh;
+   std::set<int> old;
+   std::set<int> next;
+};
+
+}
+
+std::shared_ptr<GNBA> LTL_to_GNBA_Tableau(ExprPtr expr) {
+   NNFTable table;
+   int phi = ToNNF(table, expr, false);
+
+   // nodes are finished once fresh is empty, and two finished nodes with the
+   // same old and next sets are merged
+   std::vector<TableauNode> done;
+   std::map<std::pair<std::set<int>, std::set<int>>, int> done_index;
+   std::vector<TableauNode> pending;
+   TableauNode init;
+   init.incoming.insert(INIT);
+   init.fresh.push_back(phi);
+   pending.push_back(init);
+   while (!pending.empty()) {
+      TableauNode node = std::move(pending.back());
+      pending.pop_back();
+      if (node.fresh.empty()) {
+         auto key = std::make_pair(node.old, node.next);
+         auto it = done_index.find(key);
+         if (it != done_index.end()) {
+            done[it->second].incoming.insert(node.incoming.begin(), node.incoming.end());
+            continue;
+         }
+         int id = done.size();
+         done_index[key] = id;
+         TableauNode successor;
+         successor.incoming.insert(id);
+         successor.fresh.assign(node.next.begin(), node.next.end());
+         done.push_back(std::move(node));
+         pending.push_back(std::move(successor));
+         continue;
+      }
+      int eta = node.fresh.back();
+      node.fresh.pop_back();
+      if (node.old.count(eta)) {
+         pending.push_back(std::move(node));
+         continue;
+      }
+      const NNF &f = table.get(eta);
+      switch (f.type) {
+         case NNFType::FALSE:
+            break;
+         case NNFType::TRUE:
+            node.old.insert(eta);
+            pending.push_back(std::move(node));
+            break;
+         case NNFType::LIT:
+         case NNFType::NEG_LIT: {
+            int complement = table.find(f.type == NNFType::LIT ? NNFType::NEG_LIT : NNFType::LIT, f.left);
+            if (complement >= 0 && node.old.count(complement)) break;
+            node.old.insert(eta);
+            pending.push_back(std::move(node));
+            break;
+         }
+         case NNFType::AND:
+            node.old.insert(eta);
+            node.fresh.push_back(f.left);
+            node.fresh.push_back(f.right);
+            pending.push_back(std::move(node));
+            break;
+         case NNFType::NEXT:
+            node.old.insert(eta);
+            node.next.insert(f.left);
+            pending.push_back(std::move(node));
+            break;
+         case NNFType::OR:
+         case NNFType::UNTIL:
+         case NNFType::RELEASE: {
+            // a U b = b | (a & X(a U b)),  a R b = b & (a | X(a R b))
+            node.old.insert(eta);
+            TableauNode other = node;
+            if (f.type == NNFType::OR) {
+               node.fresh.push_back(f.left);
+               other.fresh.push_back(f.right);
+            } else if (f.type == NNFType::UNTIL) {
+               node.fresh.push_back(f.left);
+               node.next.insert(eta);
+               other.fresh.push_back(f.right);
+            } else {
+               node.fresh.push_back(f.right);
+               node.next.insert(eta);
+               other.fresh.push_back(f.left);
+               other.fresh.push_back(f.right);
+            }
+            pending.push_back(std::move(other));
+            pending.push_back(std::move(node));
+            break;
+         }
+      }
+   }
+
+   // a node reads the literals in its old set when it is left
+   std::shared_ptr<GNBA> gnba = std::make_shared<GNBA>();
+   std::vector<Cube> labels;
+   for (int i = 0; i < (int) done.size(); ++i) {
+      APMask ap = 0, care = 0;
+      for (auto &k : done[i].old) {
+         const NNF &f = table.get(k);
+         if ((f.type != NNFType::LIT && f.type != NNFType::NEG_LIT) || f.left < 0) continue;
+         care |= APBit(f.left);
+         if (f.type == NNFType::LIT) ap |= APBit(f.left);
+      }
+      labels.push_back(Cube(ap, care));
+      gnba->add_node(i, done[i].incoming.count(INIT) ? 1 : 0);
+   }
+   for (int i = 0; i < (int) done.size(); ++i) {
+      for (auto &from : done[i].incoming) {
+         if (from != INIT) gnba->add_transition(from, i, Guard(labels[from]));
+      }
+   }
+   // one acceptance set per a U b: the nodes that fulfil it or do not owe it
+   for (int k = 0; k < table.size(); ++k) {
+      if (table.get(k).type != NNFType::UNTIL) continue;
+      int right = table.get(k).right;
+      std::set<int> accepting;
+      for (int i = 0; i < (int) done.size(); ++i) {
+         if (!done[i].old.count(k) || done[i].old.count(right)) {
+            accepting.insert(i);
+         }
+      }
+      gnba->add_accepting(accepting);
+   }
+   if (gnba->get_accepting().empty()) {
+      std::set<int> accepting;
+      for (int i = 0; i < (int) done.size(); ++i) {
+         accepting.insert(i);
+      }
+      gnba->add_accepting(accepting);
+   }
+   return gnba;
+}
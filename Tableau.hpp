@@ -0,0 +1,12 @@
+#ifndef TABLEAU_HPP
+#define TABLEAU_HPP
+
+#include "NBA.hpp"
+
+// Translate a formula to a GNBA with the on-the-fly tableau construction of
+// Gerth, Peled, Vardi and Wolper. Unlike LTL_to_GNBA, which enumerates every
+// elementary set, only the states reachable from the initial obligations are
+// built, and a state only constrains the APs its literals mention.
+std::shared_ptr<GNBA> LTL_to_GNBA_Tableau(ExprPtr expr);
+
+#endif
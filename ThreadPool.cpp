@@ -0,0 +1,49 @@
+#include <thread>
+#include "ThreadPool.hpp"
+
+WorkStealingPool::WorkStealingPool(int thread_count)
+   : thread_count(thread_count > 0 ? thread_count : 1), queues(this->thread_count) {}
+
+bool WorkStealingPool::pop(int worker, int &task) {
+   std::lock_guard<std::mutex> guard(queues[worker].lock);
+   if (queues[worker].tasks.empty()) return false;
+   task = queues[worker].tasks.front();
+   queues[worker].tasks.pop_front();
+   return true;
+}
+
+bool WorkStealingPool::steal(int worker, int &task) {
+   for (int i = 1; i < thread_count; ++i) {
+      Queue &victim = queues[(worker + i) % thread_count];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (victim.tasks.empty()) continue;
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+   }
+   return false;
+}
+
+void WorkStealingPool::run(int task_count, const std::function<void(int)> &task) {
+   int block = (task_count + thread_count - 1) / thread_count;
+   for (int i = 0; i < task_count; ++i) {
+      queues[i / block].tasks.push_back(i);
+   }
+   auto worker = [&](int id) {
+      int t;
+      while (pop(id, t) || steal(id, t)) {
+         task(t);
+      }
+   };
+   if (thread_count == 1) {
+      worker(0);
+      return;
+   }
+   std::vector<std::thread> threads;
+   for (int i = 0; i < thread_count; ++i) {
+      threads.push_back(std::thread(worker, i));
+   }
+   for (auto &t : threads) {
+      t.join();
+   }
+}
@@ -0,0 +1,31 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <functional>
+
+// A pool of worker threads with one task deque per worker. Tasks are dealt
+// out in contiguous blocks; a worker takes tasks from the front of its own
+// deque and, once it is empty, steals from the back of the other deques.
+class WorkStealingPool {
+ private:
+   struct Queue {
+      std::mutex lock;
+      std::deque<int> tasks;
+   };
+   int thread_count;
+   std::vector<Queue> queues;
+   bool pop(int worker, int &task);
+   bool steal(int worker, int &task);
+ public:
+   WorkStealingPool(int thread_count);
+   int get_thread_count() const {
+      return thread_count;
+   }
+   // Run task(i) for every i in [0, task_count) and return when all are done
+   void run(int task_count, const std::function<void(int)> &task);
+};
+
+#endif
@@ -0,0 +1,333 @@
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include "Generators.hpp"
+#include "Tableau.hpp"
+#include "Reduction.hpp"
+#include "NestedDFS.hpp"
+#include "SCCProcessor.hpp"
+#include "ParallelExplorer.hpp"
+#include "PartialOrder.hpp"
+#include "Pipeline.hpp"
+#include "Stats.hpp"
+
+// Benchmark driver: checks generated formulas on generated models, times
+// every stage of the check and writes one JSON object per line.
+
+namespace {
+
+struct BenchOptions {
+   // model to run, all of them with their default sizes if empty
+   std::string model;
+   int size;
+   int degree;
+   uint64_t seed;
+   // formula family to run, all of them if empty
+   std::string family;
+   // the families are run with k = 1 .. depth
+   int depth;
+   // every stage is run repeat times and the fastest time is kept
+   int repeat;
+   std::string output;
+   // directory to write the model and the formulas to instead of running them
+   std::string emit;
+   // translator and reduction of the automata, and partial-order reduction
+   Options check;
+   BenchOptions() : size(0), degree(3), seed(1), depth(3), repeat(1) {}
+};
+
+struct Field {
+   std::string name;
+   double value;
+};
+
+double Since(std::chrono::steady_clock::time_point start) {
+   return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string MakeModel(const std::string &model, int size, const BenchOptions &options) {
+   if (model == "ring") return RingTS(size);
+   if (model == "grid") return GridTS(size);
+   if (model == "philosophers") return PhilosophersTS(size);
+   if (model == "random") return RandomTS(size, options.degree, options.seed);
+   return "";
+}
+
+int DefaultSize(const std::string &model) {
+   return model == "philosophers" ? 8 : 100000;
+}
+
+// Run every stage once. The product is expanded completely first, so that
+// both emptiness checks search the same graph, then both checks run again
+// on the fly, which is how CheckLTLByNestedDFS and CheckLTLByScc are used.
+// With --por the SCC search runs once more on the fly on the product reduced
+// by partial order, for formulas without X.
+// Sets agree to false if the results differ.
+std::vector<Field> RunOnce(const std::string &ts_text, const std::string &formula, const Options &options,
+                           bool &agree) {
+   // the expressions of the run are freed with it, as in the checker
+   ExprScope scope;
+   std::vector<Field> fields;
+   auto start = std::chrono::steady_clock::now();
+   std::istringstream ts_in(ts_text);
+   Parser ts_parser(ts_in);
+   std::shared_ptr<TS> ts = InputTS(ts_parser);
+   double ms = Since(start);
+   fields.push_back(Field{"ts_parse_ms", ms});
+   fields.push_back(Field{"ts_parse_mb_s", ts_text.size() / 1e3 / std::max(ms, 1e-6)});
+   fields.push_back(Field{"ts_states", (double) ts->get_node_count()});
+   fields.push_back(Field{"ts_edges", (double) ts->get_graph()->get_edge_count()});
+
+   start = std::chrono::steady_clock::now();
+   Parser parser(formula, ts->get_ap_table());
+   ExprPtr expr = ExprSimplify(GetExprFactory().make_unary(ExprType::NEG, parser.parse()));
+   fields.push_back(Field{"parse_ms", Since(start)});
+
+   std::shared_ptr<GNBA> gnba;
+   if (options.translator == "tableau") {
+      start = std::chrono::steady_clock::now();
+      gnba = LTL_to_GNBA_Tableau(expr);
+      fields.push_back(Field{"gnba_ms", Since(start)});
+   } else {
+      start = std::chrono::steady_clock::now();
+      std::shared_ptr<Closure> closure = std::make_shared<Closure>(expr);
+      fields.push_back(Field{"closure_ms", Since(start)});
+      fields.push_back(Field{"closure_size", (double) closure->size()});
+      start = std::chrono::steady_clock::now();
+      std::shared_ptr<ElementarySet> elementaries = std::make_shared<ElementarySet>(closure);
+      fields.push_back(Field{"elementary_ms", Since(start)});
+      fields.push_back(Field{"elementary_sets", (double) elementaries->get_elementaries().size()});
+      start = std::chrono::steady_clock::now();
+      gnba = LTL_to_GNBA(elementaries);
+      fields.push_back(Field{"gnba_ms", Since(start)});
+   }
+   fields.push_back(Field{"gnba_states", (double) gnba->get_node_count()});
+   fields.push_back(Field{"gnba_sets", (double) gnba->get_accepting_set_count()});
+
+   start = std::chrono::steady_clock::now();
+   std::shared_ptr<NBA> nba = GNBA_to_NBA(gnba);
+   fields.push_back(Field{"nba_ms", Since(start)});
+   fields.push_back(Field{"nba_states", (double) nba->get_node_count()});
+   if (options.reduce) {
+      start = std::chrono::steady_clock::now();
+      nba = ReduceNBA(nba);
+      fields.push_back(Field{"reduce_ms", Since(start)});
+      fields.push_back(Field{"reduced_states", (double) nba->get_node_count()});
+   }
+
+   start = std::chrono::steady_clock::now();
+   std::shared_ptr<Product> prod = std::make_shared<Product>(ts, nba);
+   ParallelExplorer(prod, 1).explore();
+   fields.push_back(Field{"product_ms", Since(start)});
+   fields.push_back(Field{"product_states", (double) prod->get_state_count()});
+   fields.push_back(Field{"product_edges", (double) prod->get_edge_count()});
+
+   start = std::chrono::steady_clock::now();
+   int ndfs = NestedDFSProcessor(prod).find_accepting_cycle() ? 0 : 1;
+   fields.push_back(Field{"ndfs_ms", Since(start)});
+   start = std::chrono::steady_clock::now();
+   int scc = SCCProcessor(prod).find_accepting_scc() ? 0 : 1;
+   fields.push_back(Field{"scc_ms", Since(start)});
+
+   start = std::chrono::steady_clock::now();
+   int otf_ndfs = CheckLTLByNestedDFS(ts, nba);
+   fields.push_back(Field{"otf_ndfs_ms", Since(start)});
+   start = std::chrono::steady_clock::now();
+   int otf_scc = CheckLTLByScc(ts, nba);
+   fields.push_back(Field{"otf_scc_ms", Since(start)});
+
+   agree = ndfs == scc && ndfs == otf_ndfs && ndfs == otf_scc;
+   if (options.por && !ExprHasNext(expr)) {
+      start = std::chrono::steady_clock::now();
+      std::shared_ptr<const PartialOrder> partial_order = std::make_shared<const PartialOrder>(*ts);
+      fields.push_back(Field{"partial_order_ms", Since(start)});
+      fields.push_back(Field{"independent_pairs", (double) partial_order->get_independent_pairs()});
+      start = std::chrono::steady_clock::now();
+      std::shared_ptr<Product> reduced = std::make_shared<Product>(ts, nba, ts->get_initial(), partial_order);
+      int por_scc = SCCProcessor(reduced).find_accepting_scc() ? 0 : 1;
+      fields.push_back(Field{"por_scc_ms", Since(start)});
+      fields.push_back(Field{"por_states", (double) reduced->get_state_count()});
+      agree = agree && por_scc == ndfs;
+   }
+   fields.push_back(Field{"result", (double) ndfs});
+   return fields;
+}
+
+void WriteNumber(std::ostream &os, double value) {
+   if (value == (long long) value) {
+      os << (long long) value;
+   } else {
+      std::ostringstream number;
+      number.setf(std::ios::fixed);
+      number.precision(3);
+      number << value;
+      os << number.str();
+   }
+}
+
+// Run a model and formula repeat times and write the fastest time of every
+// stage. Returns false if the checks disagree.
+bool Run(std::ostream &out, const std::string &model, int size, const std::string &family, int k,
+         const BenchOptions &options) {
+   std::string ts_text = MakeModel(model, size, options);
+   std::string formula = MakeFormula(family, k);
+   std::vector<Field> best;
+   bool agree = true;
+   for (int r = 0; r < options.repeat; ++r) {
+      bool run_agrees;
+      std::vector<Field> fields = RunOnce(ts_text, formula, options.check, run_agrees);
+      agree = agree && run_agrees;
+      if (best.empty()) {
+         best = fields;
+         continue;
+      }
+      for (int i = 0; i < (int) fields.size(); ++i) {
+         best[i].value = std::min(best[i].value, fields[i].value);
+      }
+   }
+   out << "{\"model\": \"" << model << "\", \"size\": " << size << ", \"family\": \"" << family
+       << "\", \"k\": " << k << ", \"formula\": " << JSONString(formula)
+       << ", \"translator\": \"" << options.check.translator << "\"";
+   for (auto &field : best) {
+      out << ", \"" << field.name << "\": ";
+      WriteNumber(out, field.value);
+   }
+   out << ", \"agree\": " << (agree ? "true" : "false") << "}\n";
+   out.flush();
+   if (!agree) {
+      std::cerr << "bench: the checks disagree on " << model << " " << size << " with " << formula << "\n";
+   }
+   return agree;
+}
+
+// Write the model to dir/ts.txt and the formulas of the families to
+// dir/ltl.txt, each checked on the whole TS and from the last state, so that
+// LTL can check them. Returns false if a file cannot be written.
+bool Emit(const std::string &model, int size, const std::vector<std::string> &families,
+          const BenchOptions &options) {
+   std::string ts_text = MakeModel(model, size, options);
+   std::vector<std::string> formulas;
+   for (auto &family : families) {
+      for (int k = 1; k <= options.depth; ++k) {
+         formulas.push_back(MakeFormula(family, k));
+      }
+   }
+   std::istringstream ts_in(ts_text);
+   int states;
+   ts_in >> states;
+   std::ofstream ts_file(options.emit + "/ts.txt");
+   std::ofstream ltl_file(options.emit + "/ltl.txt");
+   if (!ts_file.is_open() || !ltl_file.is_open()) {
+      std::cerr << "Cannot write to directory " << options.emit << std::endl;
+      return false;
+   }
+   ts_file << ts_text;
+   ltl_file << formulas.size() << ' ' << formulas.size() << '\n';
+   for (auto &formula : formulas) {
+      ltl_file << formula << '\n';
+   }
+   for (auto &formula : formulas) {
+      ltl_file << states - 1 << ' ' << formula << '\n';
+   }
+   return true;
+}
+
+void PrintUsage(const char *program) {
+   std::cerr << "usage: " << program << " [options]\n"
+             << "  --model M       ring, grid, philosophers or random (default: all)\n"
+             << "  --size N        states of the model, philosophers for philosophers\n"
+             << "  --degree D      successors per state of the random model (default 3)\n"
+             << "  --seed S        seed of the random model (default 1)\n"
+             << "  --family F      nested, until or response (default: all)\n"
+             << "  --depth K       run every family with k = 1 .. K (default 3)\n"
+             << "  --repeat R      keep the fastest of R runs (default 1)\n"
+             << "  --translator T  elementary (default) or tableau\n"
+             << "  --no-reduce     skip the reduction of the automata\n"
+             << "  --por           also search the product reduced by partial order\n"
+             << "  --output F      write the results to F instead of stdout\n"
+             << "  --emit DIR      write the model and the formulas to DIR/ts.txt and\n"
+             << "                  DIR/ltl.txt instead of running them (needs --model)\n";
+}
+
+bool ParseBenchOptions(int argc, char *argv[], BenchOptions &options) {
+   for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      bool has_value = i + 1 < argc;
+      if (arg == "--model" && has_value) {
+         options.model = argv[++i];
+      } else if (arg == "--size" && has_value) {
+         options.size = std::atoi(argv[++i]);
+      } else if (arg == "--degree" && has_value) {
+         options.degree = std::atoi(argv[++i]);
+      } else if (arg == "--seed" && has_value) {
+         options.seed = std::strtoull(argv[++i], nullptr, 10);
+      } else if (arg == "--family" && has_value) {
+         options.family = argv[++i];
+      } else if (arg == "--depth" && has_value) {
+         options.depth = std::atoi(argv[++i]);
+      } else if (arg == "--repeat" && has_value) {
+         options.repeat = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--translator" && has_value) {
+         options.check.translator = argv[++i];
+      } else if (arg == "--no-reduce") {
+         options.check.reduce = false;
+      } else if (arg == "--por") {
+         options.check.por = true;
+      } else if (arg == "--output" && has_value) {
+         options.output = argv[++i];
+      } else if (arg == "--emit" && has_value) {
+         options.emit = argv[++i];
+      } else {
+         return false;
+      }
+   }
+   std::vector<std::string> models = {"", "ring", "grid", "philosophers", "random"};
+   std::vector<std::string> families = {"", "nested", "until", "response"};
+   return std::find(models.begin(), models.end(), options.model) != models.end() &&
+          std::find(families.begin(), families.end(), options.family) != families.end() &&
+          (options.check.translator == "elementary" || options.check.translator == "tableau") &&
+          options.depth >= 1 && options.size >= 0 && options.degree >= 1 &&
+          (options.emit.empty() || !options.model.empty());
+}
+
+}
+
+int main(int argc, char *argv[]) {
+   BenchOptions options;
+   if (!ParseBenchOptions(argc, argv, options)) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   std::vector<std::string> models = {"ring", "grid", "philosophers", "random"};
+   std::vector<std::string> families = {"nested", "until", "response"};
+   if (!options.model.empty()) models = {options.model};
+   if (!options.family.empty()) families = {options.family};
+   if (!options.emit.empty()) {
+      int size = options.size > 0 ? options.size : DefaultSize(options.model);
+      return Emit(options.model, size, families, options) ? 0 : 1;
+   }
+   std::ofstream file;
+   if (!options.output.empty()) {
+      file.open(options.output);
+      if (!file.is_open()) {
+         std::cerr << "Cannot open file " << options.output << std::endl;
+         return 1;
+      }
+   }
+   std::ostream &out = options.output.empty() ? std::cout : file;
+   bool agree = true;
+   for (auto &model : models) {
+      int size = options.size > 0 ? options.size : DefaultSize(model);
+      for (auto &family : families) {
+         for (int k = 1; k <= options.depth; ++k) {
+            agree = Run(out, model, size, family, k, options) && agree;
+         }
+      }
+   }
+   return agree ? 0 : 2;
+}
@@ -0,0 +1,145 @@
+#include <map>
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <utility>
+#include "Generators.hpp"
+
+namespace {
+
+// A successor and the action of the edge to it
+typedef std::pair<int, int> Edge;
+
+// Write a TS from its successor lists and the labels of its states, bit 0
+// for p and bit 1 for q. A state with neither gets r, so no label line is
+// empty and the formula families can use r. The initial state is 0.
+std::string WriteTS(const std::vector<std::vector<Edge>> &succ, const std::vector<int> &labels) {
+   int edges = 0;
+   for (auto &s : succ) {
+      edges += s.size();
+   }
+   std::ostringstream os;
+   os << succ.size() << ' ' << edges << "\n0\n0\np q r\n";
+   for (int i = 0; i < (int) succ.size(); ++i) {
+      for (auto &e : succ[i]) {
+         os << i << ' ' << e.second << ' ' << e.first << '\n';
+      }
+   }
+   for (auto &label : labels) {
+      if (label & 1) os << "0 ";
+      if (label & 2) os << "1 ";
+      if (label == 0) os << "2";
+      os << '\n';
+   }
+   return os.str();
+}
+
+uint64_t Next(uint64_t &state) {
+   state ^= state << 13;
+   state ^= state >> 7;
+   state ^= state << 17;
+   return state;
+}
+
+}
+
+std::string RingTS(int n) {
+   std::vector<std::vector<Edge>> succ(n);
+   std::vector<int> labels(n);
+   for (int i = 0; i < n; ++i) {
+      succ[i].push_back(Edge((i + 1) % n, 0));
+      labels[i] = (i % 2 == 0 ? 1 : 0) | (i % 3 == 0 ? 2 : 0);
+   }
+   return WriteTS(succ, labels);
+}
+
+std::string GridTS(int n) {
+   int k = std::max(1, (int) std::ceil(std::sqrt((double) n)));
+   std::vector<std::vector<Edge>> succ(k * k);
+   std::vector<int> labels(k * k);
+   for (int y = 0; y < k; ++y) {
+      for (int x = 0; x < k; ++x) {
+         int id = y * k + x;
+         succ[id].push_back(Edge(y * k + (x + 1) % k, 0));
+         succ[id].push_back(Edge((y + 1) % k * k + x, 1));
+         labels[id] = (x == 0 ? 1 : 0) | (y == 0 ? 2 : 0);
+      }
+   }
+   return WriteTS(succ, labels);
+}
+
+// A global state holds the local state of every philosopher: 0 thinking,
+// 1 holding the left fork, 2 eating. Philosopher i eats with forks i and
+// i + 1, so fork i is taken iff philosopher i holds a fork or philosopher
+// i - 1 eats.
+std::string PhilosophersTS(int n) {
+   std::map<std::vector<int>, int> index;
+   std::vector<std::vector<int>> states;
+   std::vector<std::vector<Edge>> succ;
+   auto get_id = [&](const std::vector<int> &state) {
+      auto it = index.find(state);
+      if (it != index.end()) return it->second;
+      index[state] = states.size();
+      states.push_back(state);
+      succ.push_back(std::vector<Edge>());
+      return (int) states.size() - 1;
+   };
+   auto taken = [&](const std::vector<int> &state, int fork) {
+      return state[fork] != 0 || state[(fork + n - 1) % n] == 2;
+   };
+   get_id(std::vector<int>(n, 0));
+   for (int id = 0; id < (int) states.size(); ++id) {
+      std::vector<int> state = states[id];
+      std::vector<Edge> next;
+      for (int i = 0; i < n; ++i) {
+         std::vector<int> moved = state;
+         if (state[i] == 0 && !taken(state, i)) moved[i] = 1;
+         else if (state[i] == 1 && !taken(state, (i + 1) % n)) moved[i] = 2;
+         else if (state[i] == 2) moved[i] = 0;
+         else continue;
+         next.push_back(Edge(get_id(moved), i));
+      }
+      if (next.empty()) next.push_back(Edge(id, n));
+      succ[id] = next;
+   }
+   std::vector<int> labels(states.size());
+   for (int id = 0; id < (int) states.size(); ++id) {
+      labels[id] = (states[id][0] == 2 ? 1 : 0) | (n > 1 && states[id][1] == 2 ? 2 : 0);
+   }
+   return WriteTS(succ, labels);
+}
+
+std::string RandomTS(int n, int degree, uint64_t seed) {
+   uint64_t state = seed * 0x9e3779b97f4a7c15ull + 1;
+   std::vector<std::vector<Edge>> succ(n);
+   std::vector<int> labels(n);
+   for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < degree; ++j) {
+         succ[i].push_back(Edge(Next(state) % n, j));
+      }
+      labels[i] = Next(state) & 3;
+   }
+   return WriteTS(succ, labels);
+}
+
+std::string MakeFormula(const std::string &family, int k) {
+   const char *aps[] = {"p", "q", "r"};
+   std::string f;
+   if (family == "nested") {
+      f = "p";
+      for (int i = 0; i < k; ++i) {
+         f = std::string(i % 2 == 0 ? "F" : "G") + "(" + f + ")";
+      }
+   } else if (family == "until") {
+      f = aps[k % 3];
+      for (int i = k - 1; i >= 0; --i) {
+         f = std::string("(") + aps[i % 3] + ") U (" + f + ")";
+      }
+   } else if (family == "response") {
+      for (int i = 0; i < k; ++i) {
+         std::string g = std::string("G(") + aps[i % 3] + " -> F(" + aps[(i + 1) % 3] + "))";
+         f = i == 0 ? g : "(" + f + ") /\\ (" + g + ")";
+      }
+   }
+   return f;
+}
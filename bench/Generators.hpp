@@ -0,0 +1,38 @@
+#ifndef GENERATORS_HPP
+#define GENERATORS_HPP
+
+#include <string>
+#include <cstdint>
+
+// Parametric models and formulas for the benchmarks.
+// The models are written in the text TS format, so reading them is timed
+// like reading a TS file. Every model has the APs p, q and r, where r holds
+// in the states with neither p nor q, so no label line is empty.
+// The actions are what partial-order reduction can use: the moves of a
+// philosopher or the direction of a move are one action each.
+
+// n states in a cycle; p holds in the even states, q in the multiples of 3
+std::string RingTS(int n);
+
+// A k x k torus with k * k >= n, moving right (action 0) or down (action 1);
+// p holds in the first column, q in the first row
+std::string GridTS(int n);
+
+// The reachable states of n dining philosophers who take the left fork,
+// then the right one, eat and put both back; p holds while philosopher 0
+// eats, q while philosopher 1 eats. Philosopher i moves with action i, and
+// a deadlock gets a self-loop with action n.
+std::string PhilosophersTS(int n);
+
+// n states with degree successors each, picked at random from seed along
+// with the labels; the j-th edge of a state has action j
+std::string RandomTS(int n, int degree, uint64_t seed);
+
+// Formula families over p, q and r with a size parameter k >= 1:
+//  - nested: k alternating F and G around p, e.g. G(F(p)) for k = 2
+//  - until: a chain of k untils, e.g. (p) U ((q) U (r)) for k = 2
+//  - response: a conjunction of k formulas G(a -> F(b))
+// Returns an empty string for an unknown family.
+std::string MakeFormula(const std::string &family, int k);
+
+#endif
@@ -1,171 +1,315 @@
 #include "TS.hpp"
+#include "TSFile.hpp"
 #include "NBA.hpp"
 #include "Expr.hpp"
 #include "Parser.hpp"
-#include "Product.hpp"
-#include "NestedDFS.hpp"
-#include "SCCProcessor.hpp"
+#include "ThreadPool.hpp"
+#include "AutomatonCache.hpp"
+#include "Options.hpp"
+#include "Pipeline.hpp"
+#include "Stats.hpp"
+#include "PartialOrder.hpp"
 #include <assert.h>
+#include <map>
+#include <thread>
+#include <chrono>
 #include <fstream>
+#include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #define QUOTE(name) #name
 #define STR(macro) QUOTE(macro)
 
-int read_number(Parser &parser) {
-   Token token = parser.consume();
-   assert(token.type == TOKEN_TYPE::NUMBER);
-   return token.number;
+// read LTL expression and transform it to NBA, reusing the NBA of an equal
+// formula from the cache. The translation stats are only recorded by the
+// query that translates. The expressions of the query live in a scope of
+// their own and are freed together once the automaton is built.
+std::shared_ptr<NBA_base> ParseExprAndTrans(Parser & parser, AutomatonCache &cache, const Options &options,
+                                            Stats *stats) {
+   ExprScope scope;
+   StageTimer timer(stats);
+   ExprPtr expr = parser.parse();
+   expr = ExprSimplify(GetExprFactory().make_unary(ExprType::NEG, expr));
+   timer.stage("parse");
+   bool translated = false;
+   std::shared_ptr<NBA_base> nba = cache.get(ExprCanonical(expr), [&]() {
+      translated = true;
+      return TransExpr(expr, options, stats);
+   });
+   if (stats) stats->add_bool("cache_hit", !translated);
+   parser.consume_until_endline();
+   return nba;
 }
 
-int CheckLTLByNestedDFS(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba) {
-   std::shared_ptr<TS> prod = ProductTSWithNBA(ts, nba);
-   std::shared_ptr<NestedDFSProcessor> proc = std::make_shared<NestedDFSProcessor>(prod->get_node_count());
-   for (int i = 0; i < prod->get_node_count(); ++i) {
-      for (auto &to : prod->get_node(i)->get_transition()) {
-         proc->add_edge(i, to);
-      }
+// A line of the LTL file: either a formula checked from the initial states
+// of the TS, or a state id followed by a formula checked from that state
+struct Query {
+   bool from_state;
+   std::string text;
+   // filled in when the line is parsed
+   int state;
+   std::shared_ptr<NBA_base> nba;
+   // filled in with --stats
+   Stats stats;
+   // filled in with --counterexample if the formula does not hold
+   Lasso lasso;
+};
+
+// read the LTL file. The first line holds n and m, followed by n lines with
+// a formula and m lines with a state id and a formula. The file is read in
+// one block and split into lines in memory.
+std::vector<Query> InputQueries(std::istream &fin, const Options &options) {
+   auto start = std::chrono::steady_clock::now();
+   std::ostringstream content;
+   content << fin.rdbuf();
+   const std::string &text = content.str();
+   std::vector<std::string> lines;
+   size_t begin = 0;
+   while (begin < text.size()) {
+      size_t end = text.find('\n', begin);
+      size_t next = end == std::string::npos ? text.size() : end + 1;
+      if (end == std::string::npos) end = text.size();
+      // lines of files written on Windows end in \r\n
+      if (end > begin && text[end - 1] == '\r') --end;
+      if (text.find_first_not_of(" \t\r", begin) < end) lines.push_back(text.substr(begin, end - begin));
+      begin = next;
    }
-   std::vector<int> reachable = proc->reachable_from(prod->get_initial());
-   for (auto &id : reachable) {
-      TSNodePtr node = prod->get_node(id);
-      if (node->get_ap().find("accepting") != node->get_ap().end()) {
-         if (proc->circle_check(id)) {
-            return 0;
-         }
-      }
+   std::vector<Query> queries;
+   if (lines.empty()) return queries;
+   Parser parser(lines[0]);
+   int n = read_number(parser);
+   int m = read_number(parser);
+   for (int i = 1; i <= n + m && i < (int) lines.size(); ++i) {
+      queries.push_back(Query{i > n, lines[i], -1, nullptr, Stats(), Lasso()});
    }
-   return 1;
+   if (options.verbose) {
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      std::cerr << "queries: " << queries.size() << ", " << text.size() << " bytes, " << ms << " ms, "
+                << text.size() / 1e3 / std::max(ms, 1e-6) << " MB/s\n";
+   }
+   return queries;
 }
 
-// check if the TS satisfies the LTL formula
-int CheckLTLByScc(std::shared_ptr<TS> ts, std::shared_ptr<NBA> nba) {
-   std::shared_ptr<TS> prod = ProductTSWithNBA(ts, nba);
-   std::shared_ptr<SCCProcessor> scc = std::make_shared<SCCProcessor>(prod->get_node_count());
-   for (int i = 0; i < prod->get_node_count(); ++i) {
-      for (auto &to : prod->get_node(i)->get_transition()) {
-         scc->add_edge(i, to);
-      }
-   }
-   scc->calc_scc();
-   std::vector<int> reachable = scc->reachable_from(prod->get_initial());
-   for (auto &id : reachable) {
-      TSNodePtr node = prod->get_node(id);
-      if (node->get_ap().find("accepting") != node->get_ap().end()) {
-         int belong = scc->get_scc_belong(id);
-         if (scc->scc_contains_circle(belong)) {
-            return 0;
-         }
-      }
+// Queries parse their own line, so several queries can be translated at once.
+// A query from a state that is not in the TS is left without an automaton.
+void TransQuery(std::shared_ptr<TS> ts, Query &query, AutomatonCache &cache, const Options &options) {
+   Parser parser(query.text, ts->get_ap_table());
+   if (query.from_state) {
+      query.state = read_number(parser);
+      if (query.state < 0 || query.state >= ts->get_node_count()) return;
    }
-   return 1;
+   query.nba = ParseExprAndTrans(parser, cache, options, options.stats_path.empty() ? nullptr : &query.stats);
 }
 
-// read TS from input stream
-std::shared_ptr<TS> InputTS(std::istream &fin) {
-   std::shared_ptr<TS> ts = std::make_shared<TS>();
-   int n, m;
-   Parser parser(fin);
-   Token token;
-   n = read_number(parser);
-   m = read_number(parser);
-   parser.consume_until_endline();
-   std::set<int> initials;
-   while (1) {
-      token = parser.consume();
-      if (token.type == TOKEN_TYPE::ENDLINE || token.type == TOKEN_TYPE::NONE) break;
-      assert(token.type == TOKEN_TYPE::NUMBER);
-      initials.insert(token.number);
+// Write one JSON object per query, in input order
+void WriteStats(const std::vector<Query> &queries, const std::vector<int> &results, const std::string &path) {
+   std::ofstream out(path);
+   if (!out.is_open()) {
+      std::cerr << "Cannot open file " << path << std::endl;
+      return;
    }
-   parser.consume_until_endline();
-   std::vector<std::string> aps;
-   while (1) {
-      token = parser.consume();
-      if (token.type == TOKEN_TYPE::ENDLINE || token.type == TOKEN_TYPE::NONE) break;
-      assert(token.type == TOKEN_TYPE::VAR);
-      aps.push_back(token.var_name);
-   }
-   ts->set_ap(std::set<std::string>(aps.begin(), aps.end()));
-   std::vector<std::vector<int>> transition(n);
-   for (int i = 0; i < m; ++i) {
-      int from, to;
-      from = read_number(parser);
-      read_number(parser);                   // ignore action
-      to = read_number(parser);
-      parser.consume_until_endline();
-      transition[from].push_back(to);
-   }
-   for (int i = 0; i < n; ++i) {
-      std::set<std::string> ap;
-      while (1) {
-         token = parser.consume();
-         if (token.type == TOKEN_TYPE::ENDLINE || token.type == TOKEN_TYPE::NONE) break;
-         assert(token.type == TOKEN_TYPE::NUMBER);
-         if (token.number > -1) ap.insert(aps[token.number]);
-      }
-      TSNodePtr node = std::make_shared<TSNode>(i, initials.find(i) != initials.end(), ap);
-      ts->add_node(node);
+   for (int i = 0; i < (int) queries.size(); ++i) {
+      Stats line;
+      line.add("query", i + 1);
+      line.add_string("text", queries[i].text);
+      if (queries[i].from_state) line.add("state", queries[i].state);
+      line.add("result", results[i]);
+      line.append(queries[i].stats);
+      line.write(out);
    }
-   for (int i = 0; i < n; ++i) {
-      for (auto &to : transition[i]) {
-         ts->add_transition(i, to);
-      }
+}
+
+void WriteStates(std::ostream &out, const std::vector<int> &states) {
+   out << "[";
+   for (int i = 0; i < (int) states.size(); ++i) {
+      out << (i ? ", " : "") << states[i];
    }
-   return ts;
+   out << "]";
 }
 
-// read LTL expression and transform it to NBA
-std::shared_ptr<NBA> ParseExprAndTrans(Parser & parser) {
-   ExprPtr expr = parser.parse();
-   expr = ExprSimplify(std::make_shared<UnaryExpr>(ExprType::NEG, expr));
-   std::shared_ptr<Closure> closure = std::make_shared<Closure>(expr);
-   ElementarySet elementaries(closure);
-   std::shared_ptr<GNBA> gnba = LTL_to_GNBA(std::make_shared<ElementarySet>(elementaries));
-   std::shared_ptr<NBA> nba = GNBA_to_NBA(gnba);
-   parser.consume_until_endline();
-   return nba;
+// Write the violating run of every query whose formula does not hold as one
+// JSON object per line: the TS states of prefix are followed by the TS
+// states of cycle repeated forever
+void WriteCounterexamples(const std::vector<Query> &queries, const std::vector<int> &results,
+                          const std::string &path) {
+   std::ofstream out(path);
+   if (!out.is_open()) {
+      std::cerr << "Cannot open file " << path << std::endl;
+      return;
+   }
+   for (int i = 0; i < (int) queries.size(); ++i) {
+      if (results[i] != 0 || queries[i].lasso.cycle.empty()) continue;
+      out << "{\"query\": " << i + 1 << ", \"prefix\": ";
+      WriteStates(out, queries[i].lasso.prefix);
+      out << ", \"cycle\": ";
+      WriteStates(out, queries[i].lasso.cycle);
+      out << "}\n";
+   }
 }
 
-void InputLTL(std::shared_ptr<TS> ts, std::istream &fin) {
-   int n, m;
-   Parser parser(fin);
-   Token token;
-   n = read_number(parser);
-   m = read_number(parser);
-   parser.consume_until_endline();
-   for (int i = 1; i <= n; ++i) {
-      std::shared_ptr<NBA> nba = ParseExprAndTrans(parser);
-      std::cout << CheckLTLByNestedDFS(ts, nba) << std::endl;
-   }
-   for (int i = 1; i <= m; ++i) {
-      token = parser.consume();
-      assert(token.type == TOKEN_TYPE::NUMBER);
-      int id = token.number;
-      std::shared_ptr<NBA> nba = ParseExprAndTrans(parser);
-      std::shared_ptr<TS> new_ts = ts->adjust_initial(id);
-      std::cout << CheckLTLByNestedDFS(new_ts, nba) << std::endl;
+// Translate and check all queries on a pool of worker threads and print the
+// results in input order. Queries from single states that end up with the
+// same automaton are answered together by one product exploration.
+// Returns false if a result differs from the sequential SCC search.
+bool InputLTL(std::shared_ptr<TS> ts, std::istream &fin, const Options &options) {
+   std::vector<Query> queries = InputQueries(fin, options);
+   std::vector<int> results(queries.size());
+   AutomatonCache cache;
+   WorkStealingPool pool(options.thread_count);
+   pool.run(queries.size(), [&](int i) {
+      TransQuery(ts, queries[i], cache, options);
+   });
+   for (int i = 0; i < (int) queries.size(); ++i) {
+      if (!queries[i].nba) {
+         failwith("query %d: %d is not a state of the TS\n", i + 1, queries[i].state);
+         exit(EXIT_FAILURE);
+      }
    }
+   std::vector<std::vector<int>> groups;
+   std::map<NBA_base*, int> group_of;
+   for (int i = 0; i < (int) queries.size(); ++i) {
+      // a counterexample or a bitstate search needs a search of its own
+      if (!queries[i].from_state || !options.counterexample_path.empty() || options.bitstate_bytes > 0) {
+         groups.push_back(std::vector<int>{i});
+         continue;
+      }
+      auto it = group_of.find(queries[i].nba.get());
+      if (it == group_of.end()) {
+         it = group_of.insert(std::make_pair(queries[i].nba.get(), (int) groups.size())).first;
+         groups.push_back(std::vector<int>());
+      }
+      groups[it->second].push_back(i);
+   }
+   pool.run(groups.size(), [&](int g) {
+      std::vector<int> &group = groups[g];
+      Query &first = queries[group[0]];
+      Stats check;
+      Stats *stats = options.stats_path.empty() ? nullptr : &check;
+      Lasso *lasso = options.counterexample_path.empty() ? nullptr : &first.lasso;
+      if (!first.from_state) {
+         results[group[0]] = CheckLTL(ts, first.nba, ts->get_initial(), options, stats, lasso);
+      } else if (group.size() == 1) {
+         results[group[0]] = CheckLTL(ts, first.nba, std::vector<int>{first.state}, options, stats, lasso);
+      } else {
+         std::vector<int> states;
+         for (auto &i : group) {
+            states.push_back(queries[i].state);
+         }
+         std::vector<int> result = CheckLTLFromStates(ts, first.nba, states, options, stats);
+         for (int k = 0; k < (int) group.size(); ++k) {
+            results[group[k]] = result[k];
+         }
+      }
+      if (stats) {
+         // the queries of a group share one product
+         stats->add("group_size", group.size());
+         for (auto &i : group) {
+            queries[i].stats.append(check);
+         }
+      }
+   });
+   for (auto &result : results) {
+      std::cout << result << '\n';
+   }
+   std::cout.flush();
+   if (options.bitstate_bytes > 0) {
+      std::cerr << "bitstate search: a 0 is certain, a 1 may miss a violation in the states it skipped\n";
+   }
+   if (!options.stats_path.empty()) {
+      WriteStats(queries, results, options.stats_path);
+   }
+   if (!options.counterexample_path.empty()) {
+      WriteCounterexamples(queries, results, options.counterexample_path);
+   }
+   if (options.verbose) {
+      std::cerr << "automaton cache: " << cache.get_hits() << " hits, " << cache.get_misses() << " misses\n";
+   }
+   if (!options.cross_check) return true;
+   std::vector<int> expected(queries.size());
+   pool.run(queries.size(), [&](int i) {
+      std::vector<int> initial = queries[i].from_state ? std::vector<int>{queries[i].state} : ts->get_initial();
+      expected[i] = CheckLTLByScc(ts, queries[i].nba, initial);
+   });
+   bool agree = true;
+   for (int i = 0; i < (int) queries.size(); ++i) {
+      if (results[i] != expected[i]) {
+         std::cerr << "cross-check: query " << i + 1 << " gave " << results[i] << ", the SCC search gives "
+                   << expected[i] << "\n";
+         agree = false;
+      }
+   }
+   return agree;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
    std::string project_root_dir = std::string(STR(PROJECT_ROOT_DIR));
    project_root_dir = project_root_dir.substr(1, project_root_dir.size() - 2);
-   std::string ts_in_path = project_root_dir + "/testcases/TS.txt";
-   std::string ltl_in_path = project_root_dir + "/testcases/sample.txt";
-   std::ifstream ts_in(ts_in_path);
-   if (!ts_in.is_open()) {
-      std::cerr << "Cannot open file " << ts_in_path << std::endl;
+   Options options;
+   options.ts_path = project_root_dir + "/testcases/TS.txt";
+   options.ltl_path = project_root_dir + "/testcases/sample.txt";
+   if (!ParseOptions(argc, argv, options)) {
       return 1;
    }
-   std::ifstream ltl_in(ltl_in_path);
+   if (options.thread_count == 0) {
+      options.thread_count = std::max(1u, std::thread::hardware_concurrency());
+   }
+   if (options.bitstate_bytes > 0 && options.generalized) {
+      std::cerr << "The bitstate search needs an NBA, --generalized is ignored\n";
+      options.generalized = false;
+   }
+   auto start = std::chrono::steady_clock::now();
+   std::shared_ptr<TS> ts;
+   // bytes of text parsed, 0 for a binary TS
+   long long bytes = 0;
+   if (IsBinaryTS(options.ts_path)) {
+      ts = LoadBinaryTS(options.ts_path);
+      if (!ts) return 1;
+   } else {
+      std::ifstream ts_in(options.ts_path);
+      if (!ts_in.is_open()) {
+         std::cerr << "Cannot open file " << options.ts_path << std::endl;
+         return 1;
+      }
+      Parser parser(ts_in);
+      ts = InputTS(parser);
+      bytes = parser.get_bytes_read();
+   }
+   if (options.verbose) {
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      std::cerr << "TS: " << ts->get_node_count() << " states " << ts->get_graph()->get_edge_count() << " edges, "
+                << ms << " ms";
+      if (bytes > 0) std::cerr << ", " << bytes / 1e3 / std::max(ms, 1e-6) << " MB/s";
+      std::cerr << "\n";
+   }
+   if (!options.binary_path.empty()) {
+      return SaveBinaryTS(ts, options.binary_path) ? 0 : 1;
+   }
+   if (options.por) {
+      start = std::chrono::steady_clock::now();
+      if (!ts->has_actions()) {
+         std::cerr << "The TS has no actions, so it is not reduced\n";
+      } else {
+         std::shared_ptr<const PartialOrder> partial_order = std::make_shared<const PartialOrder>(*ts);
+         if (partial_order->is_usable()) {
+            ts->set_partial_order(partial_order);
+         } else {
+            std::cerr << "The TS has more than " << PartialOrder::MAX_ACTIONS << " actions, so it is not reduced\n";
+         }
+         if (options.verbose) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cerr << "partial order: " << partial_order->get_action_count() << " actions, "
+                      << partial_order->get_independent_pairs() << " independent pairs, " << ms << " ms\n";
+         }
+      }
+   }
+   std::ifstream ltl_in(options.ltl_path);
    if (!ltl_in.is_open()) {
-      std::cerr << "Cannot open file " << ltl_in_path << std::endl;
+      std::cerr << "Cannot open file " << options.ltl_path << std::endl;
       return 1;
    }
-   std::shared_ptr<TS> ts = InputTS(ts_in);
-   InputLTL(ts, ltl_in);
-   return 0;
+   return InputLTL(ts, ltl_in, options) ? 0 : 2;
 }
 
 #undef QUOTE
-#undef STR
\ No newline at end of file
+#undef STR
@@ -0,0 +1,28 @@
+# Checks the queries of LTL_FILE on TS_FILE with the parallel OWCTY search
+# and compares every result with the sequential SCC search. With BENCH set,
+# the model and the queries are first generated into WORK_DIR by
+# LTL_bench --emit with the arguments in BENCH_ARGS.
+# Run as cmake -DLTL=... -DTS_FILE=... -DLTL_FILE=... -P CrossCheck.cmake
+
+if(BENCH)
+  file(MAKE_DIRECTORY ${WORK_DIR})
+  separate_arguments(BENCH_ARGS)
+  execute_process(
+    COMMAND ${BENCH} ${BENCH_ARGS} --emit ${WORK_DIR}
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "LTL_bench --emit failed with ${result}")
+  endif()
+  set(TS_FILE ${WORK_DIR}/ts.txt)
+  set(LTL_FILE ${WORK_DIR}/ltl.txt)
+endif()
+
+execute_process(
+  COMMAND ${LTL} --parallel-check --explore-threads 4 --cross-check ${TS_FILE} ${LTL_FILE}
+  RESULT_VARIABLE result
+  OUTPUT_QUIET
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "LTL exited with ${result} on ${TS_FILE} and ${LTL_FILE}")
+endif()